@@ -0,0 +1,298 @@
+#include "thread.h"
+
+#if defined( _WIN32 )
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	include <process.h>
+#	include <limits.h>
+#else
+#	include <pthread.h>
+#	include <sched.h>
+#	include <time.h>
+#	include <unistd.h>
+#endif
+
+namespace core
+{
+	struct ThreadEntry
+	{
+#if defined( _WIN32 )
+		static unsigned __stdcall Run( void* pArgument )
+		{
+			Thread& thread = *static_cast< Thread* >( pArgument );
+			thread.m_function( thread.m_pArgument );
+			return 0;
+		}
+#else
+		static void* Run( void* pArgument )
+		{
+			Thread& thread = *static_cast< Thread* >( pArgument );
+			thread.m_function( thread.m_pArgument );
+			return NULL;
+		}
+#endif
+	};
+
+#if !defined( _WIN32 )
+	struct SemaphoreImpl
+	{
+		pthread_mutex_t mutex;
+		pthread_cond_t condition;
+		int count;
+	};
+#endif
+}
+
+core::Thread::Thread()
+	: m_handle()
+	, m_function()
+	, m_pArgument()
+{
+}
+
+core::Thread::~Thread()
+{
+	CORE_ASSERT( !IsStarted() );
+}
+
+bool core::Thread::Start( ThreadFunction_t function, void* pArgument )
+{
+	CORE_ASSERT( !IsStarted() );
+	m_function = function;
+	m_pArgument = pArgument;
+
+#if defined( _WIN32 )
+	uintptr_t handle = _beginthreadex( NULL, 0, &ThreadEntry::Run, this, 0, NULL );
+	if( handle == 0 )
+		return false;
+	m_handle = reinterpret_cast< void* >( handle );
+#else
+	pthread_t* pThread = CORE_NEW pthread_t;
+	if( pthread_create( pThread, NULL, &ThreadEntry::Run, this ) != 0 )
+	{
+		delete pThread;
+		return false;
+	}
+	m_handle = pThread;
+#endif
+	return true;
+}
+
+void core::Thread::Join()
+{
+	if( !IsStarted() )
+		return;
+
+#if defined( _WIN32 )
+	HANDLE handle = static_cast< HANDLE >( m_handle );
+	WaitForSingleObject( handle, INFINITE );
+	CloseHandle( handle );
+#else
+	pthread_t* pThread = static_cast< pthread_t* >( m_handle );
+	pthread_join( *pThread, NULL );
+	delete pThread;
+#endif
+	m_handle = NULL;
+}
+
+bool core::Thread::IsStarted() const
+{
+	return m_handle != NULL;
+}
+
+
+core::Mutex::Mutex()
+	: m_handle()
+{
+#if defined( _WIN32 )
+	CRITICAL_SECTION* pSection = CORE_NEW CRITICAL_SECTION;
+	InitializeCriticalSection( pSection );
+	m_handle = pSection;
+#else
+	pthread_mutex_t* pMutex = CORE_NEW pthread_mutex_t;
+	pthread_mutex_init( pMutex, NULL );
+	m_handle = pMutex;
+#endif
+}
+
+core::Mutex::~Mutex()
+{
+#if defined( _WIN32 )
+	CRITICAL_SECTION* pSection = static_cast< CRITICAL_SECTION* >( m_handle );
+	DeleteCriticalSection( pSection );
+	delete pSection;
+#else
+	pthread_mutex_t* pMutex = static_cast< pthread_mutex_t* >( m_handle );
+	pthread_mutex_destroy( pMutex );
+	delete pMutex;
+#endif
+	m_handle = NULL;
+}
+
+void core::Mutex::Lock()
+{
+#if defined( _WIN32 )
+	EnterCriticalSection( static_cast< CRITICAL_SECTION* >( m_handle ) );
+#else
+	pthread_mutex_lock( static_cast< pthread_mutex_t* >( m_handle ) );
+#endif
+}
+
+void core::Mutex::Unlock()
+{
+#if defined( _WIN32 )
+	LeaveCriticalSection( static_cast< CRITICAL_SECTION* >( m_handle ) );
+#else
+	pthread_mutex_unlock( static_cast< pthread_mutex_t* >( m_handle ) );
+#endif
+}
+
+
+core::MutexLock::MutexLock( Mutex& mutex )
+	: m_mutex( mutex )
+{
+	m_mutex.Lock();
+}
+
+core::MutexLock::~MutexLock()
+{
+	m_mutex.Unlock();
+}
+
+
+core::Semaphore::Semaphore( int initialCount )
+	: m_handle()
+{
+#if defined( _WIN32 )
+	m_handle = CreateSemaphore( NULL, initialCount, LONG_MAX, NULL );
+#else
+	SemaphoreImpl* pImpl = CORE_NEW SemaphoreImpl;
+	pthread_mutex_init( &pImpl->mutex, NULL );
+	pthread_cond_init( &pImpl->condition, NULL );
+	pImpl->count = initialCount;
+	m_handle = pImpl;
+#endif
+}
+
+core::Semaphore::~Semaphore()
+{
+#if defined( _WIN32 )
+	CloseHandle( static_cast< HANDLE >( m_handle ) );
+#else
+	SemaphoreImpl* pImpl = static_cast< SemaphoreImpl* >( m_handle );
+	pthread_cond_destroy( &pImpl->condition );
+	pthread_mutex_destroy( &pImpl->mutex );
+	delete pImpl;
+#endif
+	m_handle = NULL;
+}
+
+void core::Semaphore::Wait()
+{
+#if defined( _WIN32 )
+	WaitForSingleObject( static_cast< HANDLE >( m_handle ), INFINITE );
+#else
+	SemaphoreImpl& impl = *static_cast< SemaphoreImpl* >( m_handle );
+	pthread_mutex_lock( &impl.mutex );
+	while( impl.count <= 0 )
+		pthread_cond_wait( &impl.condition, &impl.mutex );
+	--impl.count;
+	pthread_mutex_unlock( &impl.mutex );
+#endif
+}
+
+void core::Semaphore::Signal( int count )
+{
+	CORE_ASSERT( count > 0 );
+#if defined( _WIN32 )
+	ReleaseSemaphore( static_cast< HANDLE >( m_handle ), count, NULL );
+#else
+	SemaphoreImpl& impl = *static_cast< SemaphoreImpl* >( m_handle );
+	pthread_mutex_lock( &impl.mutex );
+	impl.count += count;
+	if( count == 1 )
+		pthread_cond_signal( &impl.condition );
+	else
+		pthread_cond_broadcast( &impl.condition );
+	pthread_mutex_unlock( &impl.mutex );
+#endif
+}
+
+
+long core::AtomicIncrement( volatile long& value )
+{
+#if defined( _WIN32 )
+	return InterlockedIncrement( &value );
+#else
+	return __sync_add_and_fetch( &value, 1 );
+#endif
+}
+
+long core::AtomicDecrement( volatile long& value )
+{
+#if defined( _WIN32 )
+	return InterlockedDecrement( &value );
+#else
+	return __sync_sub_and_fetch( &value, 1 );
+#endif
+}
+
+long core::AtomicCompareExchange( volatile long& value, long exchange, long comparand )
+{
+#if defined( _WIN32 )
+	return InterlockedCompareExchange( &value, exchange, comparand );
+#else
+	return __sync_val_compare_and_swap( &value, comparand, exchange );
+#endif
+}
+
+long core::AtomicLoad( volatile long& value )
+{
+	return AtomicCompareExchange( value, 0, 0 );
+}
+
+void core::AtomicStore( volatile long& value, long newValue )
+{
+#if defined( _WIN32 )
+	InterlockedExchange( &value, newValue );
+#else
+	// a full barrier, so the store publishes every write made before it
+	__atomic_store_n( &value, newValue, __ATOMIC_SEQ_CST );
+#endif
+}
+
+int core::NumHardwareThreads()
+{
+#if defined( _WIN32 )
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo( &systemInfo );
+	return (int)systemInfo.dwNumberOfProcessors;
+#else
+	long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+	return numProcessors > 0 ? (int)numProcessors : 1;
+#endif
+}
+
+void core::YieldThread()
+{
+#if defined( _WIN32 )
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+double core::HighResolutionTime()
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency( &frequency );
+	QueryPerformanceCounter( &counter );
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+namespace core
+{
+	// Minimal threading layer: thin wrappers over Win32 (or pthreads elsewhere) objects.
+	// Native handles are kept opaque to avoid platform headers in the interface.
+
+	typedef void (*ThreadFunction_t)( void* pArgument );
+
+	class Thread
+	{
+	public:
+		Thread();
+		~Thread();
+
+		bool Start( ThreadFunction_t function, void* pArgument );
+		void Join();
+		bool IsStarted() const;
+
+	private:
+		Thread( const Thread& );
+		Thread& operator=( const Thread& );
+
+		void* m_handle;
+		ThreadFunction_t m_function;
+		void* m_pArgument;
+
+		friend struct ThreadEntry;
+	};
+
+	class Mutex
+	{
+	public:
+		Mutex();
+		~Mutex();
+
+		void Lock();
+		void Unlock();
+
+	private:
+		Mutex( const Mutex& );
+		Mutex& operator=( const Mutex& );
+
+		void* m_handle;
+	};
+
+	class MutexLock
+	{
+	public:
+		explicit MutexLock( Mutex& mutex );
+		~MutexLock();
+
+	private:
+		MutexLock( const MutexLock& );
+		MutexLock& operator=( const MutexLock& );
+
+		Mutex& m_mutex;
+	};
+
+	class Semaphore
+	{
+	public:
+		explicit Semaphore( int initialCount = 0 );
+		~Semaphore();
+
+		void Wait();
+		void Signal( int count = 1 );
+
+	private:
+		Semaphore( const Semaphore& );
+		Semaphore& operator=( const Semaphore& );
+
+		void* m_handle;
+	};
+
+	long AtomicIncrement( volatile long& value );
+	long AtomicDecrement( volatile long& value );
+	long AtomicCompareExchange( volatile long& value, long exchange, long comparand );
+	long AtomicLoad( volatile long& value );
+	void AtomicStore( volatile long& value, long newValue );
+
+	int NumHardwareThreads();
+	void YieldThread();
+
+	// Monotonic high resolution clock, in seconds.
+	double HighResolutionTime();
+}
@@ -59,3 +59,18 @@ function processInput()
 	end
 end
 //]
+
+//[ contract_recycle
+function converse()
+	local contract = Stages:new() -- reuses a recycled instance if any
+	PAR(
+		function()
+			process1( contract )
+		end,
+		function()
+			process2( contract )
+		end
+	)
+	Stages:recycle( contract )
+end
+//]
@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 struct lua_State;
+struct lua_Debug;
 
 namespace lua
 {
@@ -24,6 +25,7 @@ namespace lua
 	const LuaRef_t LUA_NO_REF = -2; // matches LUA_NOREF
 	const int LUA_MULT_RET = -1; // matches LUA_MULTRET
 	typedef int (*CFunction_t)( lua_State*);
+	typedef void (*Hook_t)( lua_State*, lua_Debug* );
 
     namespace Return
     {
@@ -61,6 +61,11 @@ void lua::LuaStack::PushString( const char* str )
 	lua_pushstring( m_state, str );
 }
 
+void lua::LuaStack::PushLString( const char* str, size_t length )
+{
+	lua_pushlstring( m_state, str, length );
+}
+
 void lua::LuaStack::PushCFunction( int (*function)(lua_State* L) )
 {
 	lua_pushcfunction( m_state, function );
@@ -93,6 +98,23 @@ void lua::LuaStack::XMove( const LuaStack& toStack, int numValues )
 	lua_xmove( m_state, toStack.State().InternalState(), numValues );
 }
 
+void lua::LuaStack::Call( int numArgs, int numResults, int context, CFunction_t continuation )
+{
+	lua_callk( m_state, numArgs, numResults, context, continuation );
+}
+
+int lua::LuaStack::Context() const
+{
+	int context = 0;
+	lua_getctx( m_state, &context );
+	return context;
+}
+
+bool lua::LuaStack::CheckStack( int numValues ) const
+{
+	return lua_checkstack( m_state, numValues ) != 0;
+}
+
 void lua::LuaStack::Pop( int numValues )
 {
 	lua_pop(m_state, numValues);
@@ -31,6 +31,7 @@ namespace lua
 		void PushInteger( int number );
 		void PushBoolean( bool value );
 		void PushString( const char* str );
+		void PushLString( const char* str, size_t length );
 
 		void PushCFunction( int (*function)(lua_State* L) );
 		void PushLightUserData( const void* userData );
@@ -60,9 +61,16 @@ namespace lua
 		LuaState NewThread();
 
 		void XMove( const LuaStack& toStack, int numValues );
+
+		// Unprotected call which may yield: the continuation gets control back after a resume.
+		void Call( int numArgs, int numResults, int context, CFunction_t continuation );
+		// Context passed to Yield or Call, valid inside a continuation.
+		int Context() const;
 		void SetMetaTable( const LuaStackValue& value );
 		bool GetMetaTable( const LuaStackValue& value );
 
+		// Grows the stack to fit numValues more values, false if it can't grow.
+		bool CheckStack( int numValues ) const;
 		void Pop( int numValues );
 		void Insert( int position );
 		void Remove( int position );
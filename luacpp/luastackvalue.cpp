@@ -92,6 +92,11 @@ const char* lua::LuaStackValue::GetString() const
 	return lua_tostring( m_state, m_index );
 }
 
+const char* lua::LuaStackValue::GetLString( size_t& length ) const
+{
+	return lua_tolstring( m_state, m_index, &length );
+}
+
 bool lua::LuaStackValue::IsString() const
 {
 	return lua_type( m_state, m_index ) == LUA_TSTRING;
@@ -261,6 +266,17 @@ void lua::LuaStackValue::RawSetPointer( const void* ptr )
 	lua_rawsetp( m_state, m_index, ptr );
 }
 
+lua::LuaStackValue lua::LuaStackValue::PushUserValue() const
+{
+	lua_getuservalue( m_state, m_index );
+	return GetTopValue();
+}
+
+void lua::LuaStackValue::SetUserValue()
+{
+	lua_setuservalue( m_state, m_index );
+}
+
 lua::LuaStackValue lua::LuaStackValue::GetTopValue() const
 {
 	return LuaStackValue( m_state, lua_gettop(m_state) );
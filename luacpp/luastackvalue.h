@@ -37,6 +37,9 @@ namespace lua
 		void RawSetIndex( int n );
 		void RawSetPointer( const void* ptr );
 
+		LuaStackValue PushUserValue() const;
+		void SetUserValue();
+
 		LuaNumber_t GetNumber() const;
 		LuaNumber_t CheckNumber() const;
 		LuaNumber_t OptNumber( LuaNumber_t default ) const;
@@ -46,6 +49,7 @@ namespace lua
 		int OptInteger( int default ) const;
 
 		const char* GetString() const; 
+		const char* GetLString( size_t& length ) const;
 		const char* CheckString() const; 
 		const char* OptString( const char* default ) const; 
 
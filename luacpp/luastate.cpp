@@ -14,6 +14,7 @@ extern "C"
 #include <lua/src/lua.h>
 #include <lua/src/lauxlib.h>
 #include <lua/src/lualib.h>
+#include <lua/src/lstate.h>
 }
 
 static_assert( LUAI_EXTRASPACE == sizeof(void*), "Lua must be compiled with #define LUAI_EXTRASPACE sizeof(void*)" );
@@ -133,11 +134,30 @@ lua::Return::Enum lua::LuaState::Resume(int numArgs, LuaState * pStateFrom)
 	return PrintError( retValue );
 }
 
-int lua::LuaState::Yield( int numArgs )
+int lua::LuaState::Yield( int numArgs, int context, CFunction_t continuation )
 {
-	return lua_yield( m_stack.InternalState(), numArgs );
+	return lua_yieldk( m_stack.InternalState(), numArgs, context, continuation );
 };
 
+bool lua::LuaState::IsYieldable() const
+{
+	// Lua 5.2 has no public API for this: a thread can't yield across a non-yieldable C call.
+	return m_stack.InternalState()->nny == 0;
+}
+
+int lua::LuaState::StackSize() const
+{
+	return m_stack.InternalState()->stacksize;
+}
+
+void lua::LuaState::SetCountHook( Hook_t hook, int count )
+{
+	if( hook )
+		lua_sethook( m_stack.InternalState(), hook, LUA_MASKCOUNT, count );
+	else
+		lua_sethook( m_stack.InternalState(), NULL, 0, 0 );
+}
+
 lua::LuaStackValue lua::LuaState::GetTopValue() const
 {
 	return LuaStackValue( m_stack.InternalState(), GetTop() );
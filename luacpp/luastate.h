@@ -42,7 +42,14 @@ namespace lua
 
 		Return::Enum PrintError( Return::Enum result );
 
-		int Yield( int numArgs );
+		// A continuation is called instead of returning to the caller once the thread is resumed.
+		int Yield( int numArgs, int context = 0, CFunction_t continuation = NULL );
+		bool IsYieldable() const;
+		// Number of slots allocated for the thread stack.
+		int StackSize() const;
+
+		// Pass NULL to remove the hook.
+		void SetCountHook( Hook_t hook, int count );
 
 		Return::Enum Status() const;
 
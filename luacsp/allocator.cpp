@@ -0,0 +1,150 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "allocator.h"
+
+#include "host.h"
+
+namespace csp
+{
+	// keeps blocks aligned as operator new does
+	static const size_t BLOCK_HEADER_SIZE = 16;
+	static const size_t SLAB_HEADER_SIZE = 16;
+
+	static const int OVERSIZED_CLASS = -1;
+
+	static int SizeClass( size_t size )
+	{
+		int sizeClass = size > 0 ? (int)( ( size - 1 ) / BlockAllocator::SIZE_GRANULARITY ) : 0;
+		return sizeClass < BlockAllocator::NUM_SIZE_CLASSES ? sizeClass : OVERSIZED_CLASS;
+	}
+
+	static size_t ClassBlockSize( int sizeClass )
+	{
+		return BLOCK_HEADER_SIZE + ( sizeClass + 1 ) * BlockAllocator::SIZE_GRANULARITY;
+	}
+}
+
+csp::BlockAllocator::BlockAllocator( HostStats& stats )
+	: m_stats( stats )
+	, m_freeLists()
+	, m_pSlabs()
+	, m_numLiveBlocks( 0 )
+{
+	static_assert( sizeof( BlockHeader ) <= BLOCK_HEADER_SIZE, "block header doesn't fit" );
+	static_assert( sizeof( Slab ) <= SLAB_HEADER_SIZE, "slab header doesn't fit" );
+}
+
+csp::BlockAllocator::~BlockAllocator()
+{
+	CORE_ASSERT( m_numLiveBlocks == 0 );
+
+	while( m_pSlabs )
+	{
+		Slab* pNext = m_pSlabs->pNext;
+		::operator delete( m_pSlabs );
+		m_pSlabs = pNext;
+	}
+}
+
+void* csp::BlockAllocator::Allocate( size_t size, int count )
+{
+	int sizeClass = SizeClass( size );
+
+	char* pBlock;
+	if( sizeClass == OVERSIZED_CLASS )
+	{
+		pBlock = static_cast< char* >( ::operator new( BLOCK_HEADER_SIZE + size ) );
+		++m_stats.numHeapAllocations;
+	}
+	else
+	{
+		if( m_freeLists[ sizeClass ] == NULL )
+			AllocateSlab( sizeClass );
+
+		FreeBlock* pFree = m_freeLists[ sizeClass ];
+		m_freeLists[ sizeClass ] = pFree->pNext;
+
+		pBlock = reinterpret_cast< char* >( pFree );
+		++m_stats.numPooledAllocations;
+	}
+
+	BlockHeader& header = *reinterpret_cast< BlockHeader* >( pBlock );
+	header.pAllocator = this;
+	header.sizeClass = sizeClass;
+	header.count = count;
+
+	++m_numLiveBlocks;
+	return pBlock + BLOCK_HEADER_SIZE;
+}
+
+void* csp::BlockAllocator::AllocateFromHeap( size_t size )
+{
+	char* pBlock = static_cast< char* >( ::operator new( BLOCK_HEADER_SIZE + size ) );
+
+	BlockHeader& header = *reinterpret_cast< BlockHeader* >( pBlock );
+	header.pAllocator = NULL;
+	header.sizeClass = OVERSIZED_CLASS;
+	header.count = 1;
+
+	return pBlock + BLOCK_HEADER_SIZE;
+}
+
+void csp::BlockAllocator::Free( void* pMemory )
+{
+	if( pMemory == NULL )
+		return;
+
+	BlockHeader& header = Header( pMemory );
+	BlockAllocator* pAllocator = header.pAllocator;
+
+	if( pAllocator )
+	{
+		CORE_ASSERT( pAllocator->m_numLiveBlocks > 0 );
+		--pAllocator->m_numLiveBlocks;
+	}
+
+	if( header.sizeClass == OVERSIZED_CLASS )
+	{
+		::operator delete( &header );
+		return;
+	}
+
+	CORE_ASSERT( pAllocator );
+	FreeBlock* pFree = reinterpret_cast< FreeBlock* >( &header );
+	pFree->pNext = pAllocator->m_freeLists[ header.sizeClass ];
+	pAllocator->m_freeLists[ header.sizeClass ] = pFree;
+}
+
+csp::BlockAllocator::BlockHeader& csp::BlockAllocator::Header( void* pMemory )
+{
+	return *reinterpret_cast< BlockHeader* >( static_cast< char* >( pMemory ) - BLOCK_HEADER_SIZE );
+}
+
+void csp::BlockAllocator::AllocateSlab( int sizeClass )
+{
+	size_t blockSize = ClassBlockSize( sizeClass );
+	char* pMemory = static_cast< char* >( ::operator new( SLAB_HEADER_SIZE + blockSize * BLOCKS_PER_SLAB ) );
+	++m_stats.numHeapAllocations;
+
+	Slab* pSlab = reinterpret_cast< Slab* >( pMemory );
+	pSlab->pNext = m_pSlabs;
+	m_pSlabs = pSlab;
+
+	char* pBlocks = pMemory + SLAB_HEADER_SIZE;
+	for( int i = BLOCKS_PER_SLAB-1; i >= 0; --i )
+	{
+		FreeBlock* pFree = reinterpret_cast< FreeBlock* >( pBlocks + blockSize * i );
+		pFree->pNext = m_freeLists[ sizeClass ];
+		m_freeLists[ sizeClass ] = pFree;
+	}
+}
+
+int csp::BlockAllocator::NumLiveBlocks() const
+{
+	return m_numLiveBlocks;
+}
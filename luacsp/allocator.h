@@ -0,0 +1,92 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <new>
+
+#include "csp.h"
+
+namespace csp
+{
+	struct HostStats;
+
+	// Per-host size-class freelists carved from slabs, for operations and their argument arrays.
+	// Every block remembers its owner in a header, so a block is freed without knowing the host.
+	// Not thread-safe: a host is only ever updated by one thread at a time.
+	class BlockAllocator
+	{
+	public:
+		explicit BlockAllocator( HostStats& stats );
+		~BlockAllocator();
+
+		void* Allocate( size_t size, int count = 1 );
+		static void Free( void* pMemory );
+
+		// Blocks which aren't owned by any host: used by operations created with plain new.
+		static void* AllocateFromHeap( size_t size );
+
+		template< typename T > T* NewArray( int count );
+		template< typename T > static void DeleteArray( T* array );
+
+		int NumLiveBlocks() const;
+
+		static const int SIZE_GRANULARITY = 16;
+		static const int NUM_SIZE_CLASSES = 32;
+		static const int BLOCKS_PER_SLAB = 32;
+
+	private:
+		BlockAllocator( const BlockAllocator& );
+		BlockAllocator& operator=( const BlockAllocator& );
+
+		struct BlockHeader
+		{
+			BlockAllocator* pAllocator;
+			int sizeClass;
+			int count;
+		};
+
+		struct FreeBlock
+		{
+			FreeBlock* pNext;
+		};
+
+		struct Slab
+		{
+			Slab* pNext;
+		};
+
+		static BlockHeader& Header( void* pMemory );
+		void AllocateSlab( int sizeClass );
+
+		HostStats& m_stats;
+		FreeBlock* m_freeLists[ NUM_SIZE_CLASSES ];
+		Slab* m_pSlabs;
+		int m_numLiveBlocks;
+	};
+
+	template< typename T >
+	T* BlockAllocator::NewArray( int count )
+	{
+		T* array = static_cast< T* >( Allocate( sizeof( T ) * count, count ) );
+		for( int i = 0; i < count; ++i )
+			new( array + i ) T();
+		return array;
+	}
+
+	template< typename T >
+	void BlockAllocator::DeleteArray( T* array )
+	{
+		if( array == NULL )
+			return;
+
+		int count = Header( array ).count;
+		for( int i = 0; i < count; ++i )
+			array[ i ].~T();
+		Free( array );
+	}
+}
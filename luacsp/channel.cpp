@@ -18,6 +18,12 @@ namespace csp
 	int GcObject_Gc( lua_State* luaState );
 	int Channel_IN( lua_State* luaState );
 	int Channel_OUT( lua_State* luaState );
+	int Channel_IN_MANY( lua_State* luaState );
+	int Channel_OUT_MANY( lua_State* luaState );
+	int Channel_TRY_IN( lua_State* luaState );
+	int Channel_IN_TIMEOUT( lua_State* luaState );
+	int Channel_OUT_TIMEOUT( lua_State* luaState );
+	int Channel_TRY_OUT( lua_State* luaState );
 
 	int Channel_RANGE( lua_State* luaState );
 	int RANGE_next( lua_State* luaState );
@@ -34,16 +40,131 @@ namespace csp
 		"__gc", csp::GcObject_Gc
 		, "IN", csp::Channel_IN
 		, "OUT", csp::Channel_OUT
+		, "IN_MANY", csp::Channel_IN_MANY
+		, "OUT_MANY", csp::Channel_OUT_MANY
+		, "TRY_IN", csp::Channel_TRY_IN
+		, "IN_TIMEOUT", csp::Channel_IN_TIMEOUT
+		, "OUT_TIMEOUT", csp::Channel_OUT_TIMEOUT
+		, "TRY_OUT", csp::Channel_TRY_OUT
 		, "RANGE", csp::Channel_RANGE
 		, "close", csp::Channel_close
 		, NULL, NULL
 	};
+
+	// bigger item tables grow on demand
+	static const int MAX_ITEMS_PREALLOCATED = 64;
+
+	// Stores the first of the numValues values on top of the stack as an item, drops the rest.
+	static void AddItem( lua::LuaStack& stack, int itemsIndex, int numValues, int itemIndex )
+	{
+		if( numValues == 0 )
+		{
+			stack.CheckStack( 1 );
+			stack.PushNil();
+		}
+		else if( numValues > 1 )
+			stack.Pop( numValues - 1 );
+
+		stack[ itemsIndex ].RawSetIndex( itemIndex );
+	}
+
+	static int PopItemsFromBuffer( Host& host, Channel& channel, lua::LuaStack& stack
+		, int bufferIndex, int itemsIndex, int numItems, int maxItems )
+	{
+		while( numItems < maxItems && !channel.IsBufferEmpty() )
+		{
+			int numValues = channel.PopMessage( host, stack, bufferIndex );
+			AddItem( stack, itemsIndex, numValues, ++numItems );
+		}
+		return numItems;
+	}
+
+	static int PushItemsToBuffer( Channel& channel, lua::LuaStack& stack
+		, int bufferIndex, int arrayIndex, int numItemsSent, int numItems )
+	{
+		stack.CheckStack( 1 );
+		lua::LuaStackValue array = stack[ arrayIndex ];
+		while( numItemsSent < numItems && !channel.IsBufferFull() )
+		{
+			array.PushRawGetIndex( ++numItemsSent );
+			channel.PushMessage( stack, bufferIndex, 1 );
+		}
+		return numItemsSent;
+	}
+
+	// Takes the relative timeout out of the arguments, so the plain operation sees its usual arguments.
+	static bool PopTimeout( lua::LuaStack& args, CspTime_t& timeout )
+	{
+		if( !args[2].IsNumber() )
+			return false;
+
+		timeout = args[2].GetNumber();
+		args.Remove( 2 );
+		return true;
+	}
+
+	static int PushTimeoutResults( lua::LuaStack& luaStack )
+	{
+		luaStack.CheckStack( 2 );
+		luaStack.PushNil();
+		luaStack.PushString( "timeout" );
+		return 2;
+	}
+
+	static int PushClosedResults( lua::LuaStack& luaStack )
+	{
+		luaStack.CheckStack( 2 );
+		luaStack.PushNil();
+		luaStack.PushString( "closed" );
+		return 2;
+	}
+
+	// TRY_IN takes the values of a blocked writer straight onto the calling stack. Writers only wake up
+	// themselves when a reader pulls, so the reader's process is never asked for.
+	class TryInAttachment : public ChannelAttachmentIn_i
+	{
+	public:
+		explicit TryInAttachment( lua::LuaStack& stack )
+			: m_stack( stack )
+			, m_numArguments( CSP_NO_ARGS )
+		{
+		}
+
+		int NumArguments() const
+		{
+			return m_numArguments;
+		}
+
+	private:
+		virtual Process& ProcessToEvaluate()
+		{
+			// the reader is the caller of TRY_IN
+			Process* pProcess = Process::GetProcess( m_stack.InternalState() );
+			CORE_ASSERT( pProcess );
+			return *pProcess;
+		}
+
+		virtual void MoveChannelArguments( Channel&, lua::LuaStack& fromStack, int numArguments )
+		{
+			m_stack.CheckStack( numArguments );
+			fromStack.XMove( m_stack, numArguments );
+			m_numArguments = numArguments;
+		}
+
+		virtual void CloseChannel( Host&, Channel& )
+		{
+			// never attached to the channel
+		}
+
+		lua::LuaStack& m_stack;
+		int m_numArguments;
+	};
 }
 
 csp::OpChannel::OpChannel()
 	: m_pChannel()
 	, m_channelRefKey( lua::LUA_NO_REF )
-	, m_arguments()
+	, m_waiter()
 	, m_numArguments( CSP_NO_ARGS )
 	, m_argumentsMoved( false )
 {
@@ -52,14 +173,6 @@ csp::OpChannel::OpChannel()
 csp::OpChannel::~OpChannel()
 {
 	CORE_ASSERT( m_channelRefKey == lua::LUA_NO_REF );
-
-	for( int i = 0; i < m_numArguments; ++i )
-	{
-		CORE_ASSERT( m_arguments[i].refKey == lua::LUA_NO_REF );
-	}
-
-	delete[] m_arguments;
-	m_arguments = NULL;
 }
 
 bool csp::OpChannel::InitChannel( lua::LuaStack& args, InitError& initError )
@@ -81,15 +194,8 @@ bool csp::OpChannel::InitChannel( lua::LuaStack& args, InitError& initError )
 
 void csp::OpChannel::InitArguments( lua::LuaStack& args, InitError& )
 {
+	// the channel is the first argument, the values are already on top of the stack
 	m_numArguments = args.NumArgs() - 1;
-	if ( m_numArguments > 0 )
-		m_arguments = CORE_NEW ChannelArgument[ m_numArguments ];
-
-	for( int i = 2; i <= args.NumArgs(); ++i )
-	{
-		args[ i ].PushValue();
-		m_arguments[ i-2 ].refKey = args.RefInRegistry();
-	}
 }
 
 csp::WorkResult::Enum csp::OpChannel::Work( Host&, CspTime_t )
@@ -97,16 +203,30 @@ csp::WorkResult::Enum csp::OpChannel::Work( Host&, CspTime_t )
 	return WorkResult::YIELD;
 }
 
-void csp::OpChannel::Communicate( Host& host, Process& inputProcess )
+bool csp::OpChannel::RequiresWork() const
 {
-	Channel& channel = ThisChannel();
-	ChannelAttachmentIn_i& in = channel.InAttachment();
+	// channel operations are woken up by their counterparts
+	return false;
+}
+
+void csp::OpChannel::Communicate( Host& host, ChannelAttachmentIn_i& in )
+{
+	in.MoveChannelArguments( ThisChannel(), ThisProcess().LuaThread().GetStack(), NumArguments() );
+	ArgumentsMoved();	
+
+	host.PushEvalStep( ThisProcess() );
+}
 
-	in.MoveChannelArguments( channel, Arguments(), NumArguments() );
+void csp::OpChannel::HandOff( Host& host, ChannelAttachmentIn_i& in )
+{
+	Process& inputProcess = in.ProcessToEvaluate();
+
+	in.MoveChannelArguments( ThisChannel(), ThisProcess().LuaThread().GetStack(), NumArguments() );
 	ArgumentsMoved();	
 
+	// the reader resumes with the values right away, the writer goes to the eval stack once
 	host.PushEvalStep( ThisProcess() );
-	host.PushEvalStep( inputProcess );
+	host.EvaluateNext( inputProcess );
 }
 
 void csp::OpChannel::UnrefChannel( lua::LuaStack const& stack )
@@ -127,44 +247,70 @@ bool csp::OpChannel::HasChannel()
 	return m_pChannel != NULL;
 }
 
-void csp::OpChannel::UnrefArguments( lua::LuaStack const& stack )
+csp::ChannelWaiter& csp::OpChannel::Waiter()
 {
-	for( int i = 0; i < m_numArguments; ++i )
-	{
-		stack.UnrefInRegistry( m_arguments[i].refKey );
-		m_arguments[i].refKey = lua::LUA_NO_REF;
-	}
+	return m_waiter;
 }
 
+lua::LuaRef_t csp::OpChannel::ChannelRefKey() const
+{
+	return m_channelRefKey;
+}
 
-void csp::OpChannel::SetArguments( ChannelArgument* arguments, int numArguments )
+void csp::OpChannel::SetArguments( int numArguments )
 {
-	CORE_ASSERT( m_arguments == NULL );
 	CORE_ASSERT( m_numArguments == CSP_NO_ARGS );
 	CORE_ASSERT( numArguments != CSP_NO_ARGS );
 
-	m_arguments = arguments;
 	m_numArguments = numArguments;
 }
 
-void csp::OpChannel::MoveChannelArguments( ChannelArgument* arguments, int numArguments )
+void csp::OpChannel::MoveChannelArguments( lua::LuaStack& fromStack, int numArguments )
 {
-	SetArguments( arguments, numArguments );
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	stack.CheckStack( numArguments );
+	fromStack.XMove( stack, numArguments );
+
+	SetArguments( numArguments );
 	m_argumentsMoved = true;
 }
 
-void csp::OpChannel::ArgumentsMoved()
+void csp::OpChannel::MoveArgumentsToBuffer( Host& )
 {
-	m_arguments = NULL;
-	m_numArguments = CSP_NO_ARGS;
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	int numArguments = NumArguments();
+
+	// the buffer goes below the values
+	Channel::PushBuffer( stack, ChannelRefKey() );
+	int bufferIndex = stack.GetTop() - numArguments;
+	stack.Insert( bufferIndex );
+
+	ThisChannel().PushMessage( stack, bufferIndex, numArguments );
+	stack.Pop( 1 );
+
+	ArgumentsMoved();
+}
+
+bool csp::OpChannel::ReceiveFromBuffer( Host& host )
+{
+	Channel& channel = ThisChannel();
+	if( channel.IsBufferEmpty() )
+		return false;
 
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	int bufferIndex = Channel::PushBuffer( stack, ChannelRefKey() ).Index();
+	int numArguments = channel.PopMessage( host, stack, bufferIndex );
+	stack.Remove( bufferIndex );
+
+	SetArguments( numArguments );
 	m_argumentsMoved = true;
+	return true;
 }
 
-csp::ChannelArgument* csp::OpChannel::Arguments() const
+void csp::OpChannel::ArgumentsMoved()
 {
-	CORE_ASSERT( HasArguments() );
-	return m_arguments;
+	m_numArguments = CSP_NO_ARGS;
+	m_argumentsMoved = true;
 }
 
 int csp::OpChannel::NumArguments() const
@@ -185,15 +331,12 @@ bool csp::OpChannel::HasArguments() const
 
 void csp::OpChannel::Terminate( Host& host )
 {
-	lua::LuaStack& stack = host.LuaState().GetStack();
-	UnrefChannel( stack );
-	UnrefArguments( stack );
+	UnrefChannel( host.LuaState().GetStack() );
 }
 
-void csp::OpChannel::CloseChannel( Host& host, Channel& )
+void csp::OpChannel::CloseChannel( Host&, Channel& )
 {
-	lua::LuaStack& stack = host.LuaState().GetStack();
-	UnrefArguments( stack );
+	// retained values are dropped when the process resumes
 	ArgumentsMoved();
 }
 
@@ -213,13 +356,15 @@ bool csp::OpChannelOut::Init( lua::LuaStack & args, InitError& initError )
 
 	InitArguments( args, initError );
 
-	if( ThisChannel().OutAttached() )
-		return initError.ArgError( 1, "channel is in output operation already" );
-
-	ThisChannel().SetAttachmentOut( *this );
+	ThisChannel().AttachOut( Waiter(), *this );
 	return true;
 }
 
+int csp::OpChannelOut::NumRetainedValues() const
+{
+	return NumArguments();
+}
+
 csp::WorkResult::Enum csp::OpChannelOut::Evaluate( Host& host )
 {
 	Channel& channel = ThisChannel();
@@ -230,10 +375,27 @@ csp::WorkResult::Enum csp::OpChannelOut::Evaluate( Host& host )
 		return WorkResult::FINISH;
 	}
 
-	if( channel.InAttached() )
+	if( channel.IsClosed() )
+	{
+		channel.DetachOut( Waiter() );
+		UnrefChannel( host.LuaState().GetStack() );
+		return WorkResult::FINISH;
+	}
+
+	// buffered messages are older: a reader gets them first
+	if( channel.InAttached() && channel.IsBufferEmpty() )
 	{
+		// detached first: the reader runs before HandOff returns
 		ChannelAttachmentIn_i& in = channel.InAttachment();
-		Communicate( host, in.ProcessToEvaluate() );
+		channel.DetachOut( Waiter() );
+		HandOff( host, in );
+	}
+	else if( channel.CanBufferMessage() )
+	{
+		MoveArgumentsToBuffer( host );
+		channel.DetachOut( Waiter() );
+		UnrefChannel( host.LuaState().GetStack() );
+		return WorkResult::FINISH;
 	}
 
 	return WorkResult::YIELD;
@@ -244,22 +406,30 @@ csp::Process& csp::OpChannelOut::ProcessToEvaluate()
 	return ThisProcess();
 }
 
-void csp::OpChannelOut::Communicate( Host& host, Process& inputProcess )
+void csp::OpChannelOut::Communicate( Host& host, ChannelAttachmentIn_i& in )
+{
+	OpChannel::Communicate( host, in );
+	ThisChannel().DetachOut( Waiter() );
+}
+
+void csp::OpChannelOut::MoveToBuffer( Host& host )
 {
-	OpChannel::Communicate( host, inputProcess );
-	ThisChannel().ResetAttachmentOut( *this );
+	MoveArgumentsToBuffer( host );
+	ThisChannel().DetachOut( Waiter() );
+
+	host.PushEvalStep( ThisProcess() );
 }
 
 void csp::OpChannelOut::Terminate( Host& host )
 {
-	ThisChannel().ResetAttachmentOut( *this );
+	ThisChannel().DetachOut( Waiter() );
 	OpChannel::Terminate( host );
 }
 
 void csp::OpChannelOut::CloseChannel( Host& host, Channel& channel )
 {
 	OpChannel::CloseChannel( host, channel );
-	channel.ResetAttachmentOut( *this );
+	channel.DetachOut( Waiter() );
 }
 
 
@@ -276,10 +446,7 @@ bool csp::OpChannelIn::Init( lua::LuaStack & args, InitError& initError )
 	if( !InitChannel( args, initError ) )
 		return false;
 
-	if( ThisChannel().InAttached() )
-		return initError.ArgError( 1, "channel is in input operation already" );
-
-	ThisChannel().SetAttachmentIn( *this );
+	ThisChannel().AttachIn( Waiter(), *this );
 	return true;
 }
 
@@ -291,11 +458,28 @@ csp::WorkResult::Enum csp::OpChannelIn::Evaluate( Host& host )
 	{
 		return WorkResult::FINISH;
 	}
+
+	// buffered values stay readable after the channel is closed
+	if( ReceiveFromBuffer( host ) )
+	{
+		channel.DetachIn( Waiter() );
+		return WorkResult::FINISH;
+	}
+
+	// the channel was closed before we got here: nothing to wait for
+	if( channel.IsClosed() )
+	{
+		channel.DetachIn( Waiter() );
+		return WorkResult::FINISH;
+	}
 		
+	// the values are pulled right here: only the writer goes to the eval stack
 	if( channel.OutAttached() )
 	{
 		ChannelAttachmentOut_i& out = channel.OutAttachment();
-		out.Communicate( host, ThisProcess() );
+		out.Communicate( host, *this );
+		CORE_ASSERT( HasArgumentsMoved() );
+		return WorkResult::FINISH;
 	}
 
 	return WorkResult::YIELD;
@@ -306,39 +490,31 @@ csp::Process& csp::OpChannelIn::ProcessToEvaluate()
 	return ThisProcess();
 }
 
-void csp::OpChannelIn::MoveChannelArguments( Channel&, ChannelArgument* arguments, int numArguments )
+void csp::OpChannelIn::MoveChannelArguments( Channel&, lua::LuaStack& fromStack, int numArguments )
 {
-	OpChannel::MoveChannelArguments( arguments, numArguments );
-	ThisChannel().ResetAttachmentIn( *this );
+	OpChannel::MoveChannelArguments( fromStack, numArguments );
+	ThisChannel().DetachIn( Waiter() );
 }
 
 int csp::OpChannelIn::PushResults( lua::LuaStack & luaStack )
 {
-	int numArguments = 0;
-	if( HasArguments() )
-	{
-		ChannelArgument* arguments = Arguments();
-		numArguments = NumArguments();
-
-		for( int i = 0; i < numArguments; ++i )
-			luaStack.PushRegistryReferenced( arguments[i].refKey );
-	}
+	// the moved values are on top of the stack already
+	int numArguments = HasArguments() ? NumArguments() : 0;
 
-	UnrefArguments( luaStack );
 	UnrefChannel( luaStack );
 	return numArguments;
 }
 
 void csp::OpChannelIn::Terminate( Host& host )
 {
-	ThisChannel().ResetAttachmentIn( *this );
+	ThisChannel().DetachIn( Waiter() );
 	OpChannel::Terminate( host );
 }
 
 void csp::OpChannelIn::CloseChannel( Host& host, Channel& channel )
 {
 	OpChannel::CloseChannel( host, channel );
-	channel.ResetAttachmentIn( *this );
+	channel.DetachIn( Waiter() );
 }
 
 
@@ -352,69 +528,588 @@ csp::OpChannelRange::~OpChannelRange()
 
 int csp::OpChannelRange::PushResults( lua::LuaStack & luaStack )
 {
-	if( ThisChannel().IsClosed() )
+	// the channel can be closed after the values were received
+	if( ThisChannel().IsClosed() && !HasArguments() )
 		luaStack.PushNil();
 	else
 		luaStack.PushBoolean( true );
-	return OpChannelIn::PushResults( luaStack ) + 1;
+
+	int numArguments = OpChannelIn::PushResults( luaStack );
+	luaStack.Insert( luaStack.GetTop() - numArguments );
+	return numArguments + 1;
+}
+
+
+csp::OpChannelInTimeout::OpChannelInTimeout()
+	: m_timer()
+	, m_timedOut( false )
+{
+	m_timer.SetAttachment( *this );
+}
+
+csp::OpChannelInTimeout::~OpChannelInTimeout()
+{
+}
+
+bool csp::OpChannelInTimeout::Init( lua::LuaStack& args, InitError& initError )
+{
+	CspTime_t timeout = 0;
+	if( !PopTimeout( args, timeout ) )
+		return initError.ArgError( 2, "seconds expected" );
+
+	if( !OpChannelIn::Init( args, initError ) )
+		return false;
+
+	Host& host = Host::GetHost( args.InternalState() );
+	host.Timers().Schedule( m_timer, host.Time() + timeout );
+	return true;
+}
+
+csp::WorkResult::Enum csp::OpChannelInTimeout::Evaluate( Host& host )
+{
+	if( m_timedOut )
+		return WorkResult::FINISH;
+
+	WorkResult::Enum result = OpChannelIn::Evaluate( host );
+	if( result == WorkResult::FINISH )
+		host.Timers().Cancel( m_timer );
+
+	return result;
+}
+
+int csp::OpChannelInTimeout::PushResults( lua::LuaStack& luaStack )
+{
+	if( m_timedOut )
+	{
+		UnrefChannel( luaStack );
+		return PushTimeoutResults( luaStack );
+	}
+
+	// the channel was closed with nothing to read: tell it apart from a message without values
+	if( !HasArguments() )
+	{
+		UnrefChannel( luaStack );
+		return PushClosedResults( luaStack );
+	}
+
+	return OpChannelIn::PushResults( luaStack );
+}
+
+void csp::OpChannelInTimeout::Terminate( Host& host )
+{
+	host.Timers().Cancel( m_timer );
+	OpChannelIn::Terminate( host );
 }
 
+void csp::OpChannelInTimeout::ExpireTimer( Host& host )
+{
+	// the values came in or the channel closed meanwhile: the process is woken up already
+	if( HasArgumentsMoved() )
+		return;
+
+	m_timedOut = true;
+	ThisChannel().DetachIn( Waiter() );
+	host.PushEvalStep( ThisProcess() );
+}
+
+
+csp::OpChannelOutTimeout::OpChannelOutTimeout()
+	: m_timer()
+	, m_timedOut( false )
+	, m_closed( false )
+{
+	m_timer.SetAttachment( *this );
+}
+
+csp::OpChannelOutTimeout::~OpChannelOutTimeout()
+{
+}
+
+bool csp::OpChannelOutTimeout::Init( lua::LuaStack& args, InitError& initError )
+{
+	CspTime_t timeout = 0;
+	if( !PopTimeout( args, timeout ) )
+		return initError.ArgError( 2, "seconds expected" );
+
+	if( !OpChannelOut::Init( args, initError ) )
+		return false;
+
+	Host& host = Host::GetHost( args.InternalState() );
+	host.Timers().Schedule( m_timer, host.Time() + timeout );
+	return true;
+}
+
+csp::WorkResult::Enum csp::OpChannelOutTimeout::Evaluate( Host& host )
+{
+	if( m_timedOut )
+	{
+		UnrefChannel( host.LuaState().GetStack() );
+		return WorkResult::FINISH;
+	}
+
+	if( !HasArgumentsMoved() && ThisChannel().IsClosed() )
+		m_closed = true;
+
+	WorkResult::Enum result = OpChannelOut::Evaluate( host );
+	if( result == WorkResult::FINISH )
+		host.Timers().Cancel( m_timer );
+
+	return result;
+}
+
+int csp::OpChannelOutTimeout::PushResults( lua::LuaStack& luaStack )
+{
+	// the values which weren't taken are dropped from under the results
+	if( m_timedOut )
+		return PushTimeoutResults( luaStack );
+
+	// the channel was closed before a reader took the values
+	if( m_closed )
+		return PushClosedResults( luaStack );
+
+	luaStack.PushBoolean( true );
+	return 1;
+}
+
+void csp::OpChannelOutTimeout::Terminate( Host& host )
+{
+	host.Timers().Cancel( m_timer );
+	OpChannelOut::Terminate( host );
+}
+
+void csp::OpChannelOutTimeout::CloseChannel( Host& host, Channel& channel )
+{
+	m_closed = true;
+	OpChannelOut::CloseChannel( host, channel );
+}
+
+void csp::OpChannelOutTimeout::ExpireTimer( Host& host )
+{
+	if( HasArgumentsMoved() )
+		return;
+
+	m_timedOut = true;
+	ThisChannel().DetachOut( Waiter() );
+	host.PushEvalStep( ThisProcess() );
+}
+
+
+csp::OpChannelInMany::OpChannelInMany()
+	: m_maxItems( 0 )
+	, m_numItems( 0 )
+{
+}
+
+csp::OpChannelInMany::~OpChannelInMany()
+{
+}
+
+bool csp::OpChannelInMany::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !InitChannel( args, initError ) )
+		return false;
+
+	lua::LuaStackValue maxItemsArg = args[2];
+	if( !maxItemsArg.IsNumber() || maxItemsArg.GetInteger() < 1 )
+		return initError.ArgError( 2, "positive number of items expected" );
+	m_maxItems = maxItemsArg.GetInteger();
+
+	args.PushTable( m_maxItems < MAX_ITEMS_PREALLOCATED ? m_maxItems : MAX_ITEMS_PREALLOCATED );
+
+	ThisChannel().AttachIn( Waiter(), *this );
+	return true;
+}
+
+int csp::OpChannelInMany::NumRetainedValues() const
+{
+	return 1;
+}
+
+bool csp::OpChannelInMany::IsFull() const
+{
+	return m_numItems == m_maxItems;
+}
+
+csp::WorkResult::Enum csp::OpChannelInMany::Evaluate( Host& host )
+{
+	Channel& channel = ThisChannel();
+
+	if( !HasArgumentsMoved() )
+	{
+		if( !channel.IsBufferEmpty() )
+		{
+			lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+			int itemsIndex = stack.GetTop();
+			int bufferIndex = Channel::PushBuffer( stack, ChannelRefKey() ).Index();
+			m_numItems = PopItemsFromBuffer( host, channel, stack, bufferIndex, itemsIndex, m_numItems, m_maxItems );
+			stack.Remove( bufferIndex );
+		}
+
+		// every blocked writer hands over its message, OUT_MANY writers hand over as many items as fit
+		while( !IsFull() && channel.OutAttached() )
+		{
+			ChannelAttachmentOut_i& out = channel.OutAttachment();
+			out.Communicate( host, *this );
+		}
+	}
+
+	if( HasArgumentsMoved() || m_numItems > 0 || channel.IsClosed() )
+	{
+		channel.DetachIn( Waiter() );
+		return WorkResult::FINISH;
+	}
+
+	return WorkResult::YIELD;
+}
+
+csp::Process& csp::OpChannelInMany::ProcessToEvaluate()
+{
+	return ThisProcess();
+}
+
+void csp::OpChannelInMany::MoveChannelArguments( Channel&, lua::LuaStack& fromStack, int numArguments )
+{
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	int itemsIndex = stack.GetTop();
+
+	stack.CheckStack( numArguments );
+	fromStack.XMove( stack, numArguments );
+	AddItem( stack, itemsIndex, numArguments, ++m_numItems );
+
+	// a waiting reader takes more items until it's woken up
+	if( IsFull() )
+	{
+		ArgumentsMoved();
+		ThisChannel().DetachIn( Waiter() );
+	}
+}
+
+int csp::OpChannelInMany::PushResults( lua::LuaStack& luaStack )
+{
+	// the items table is on top of the stack already
+	luaStack.PushInteger( m_numItems );
 
-csp::Channel::Channel()
-	: m_pAttachmentIn()
-	, m_pAttachmentOut()
+	UnrefChannel( luaStack );
+	return 2;
+}
+
+void csp::OpChannelInMany::Terminate( Host& host )
+{
+	ThisChannel().DetachIn( Waiter() );
+	OpChannel::Terminate( host );
+}
+
+void csp::OpChannelInMany::CloseChannel( Host& host, Channel& channel )
+{
+	OpChannel::CloseChannel( host, channel );
+	channel.DetachIn( Waiter() );
+}
+
+
+csp::OpChannelOutMany::OpChannelOutMany()
+	: m_numItems( 0 )
+	, m_numItemsSent( 0 )
+{
+}
+
+csp::OpChannelOutMany::~OpChannelOutMany()
+{
+}
+
+bool csp::OpChannelOutMany::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !InitChannel( args, initError ) )
+		return false;
+
+	lua::LuaStackValue array = args[2];
+	if( !array.IsTable() )
+		return initError.ArgError( 2, "array expected" );
+
+	m_numItems = (int)array.RawLength();
+	array.PushValue();
+
+	// an empty array has nothing to offer to readers
+	if( m_numItems > 0 )
+		ThisChannel().AttachOut( Waiter(), *this );
+	return true;
+}
+
+int csp::OpChannelOutMany::NumRetainedValues() const
+{
+	return 1;
+}
+
+bool csp::OpChannelOutMany::AllItemsSent() const
+{
+	return m_numItemsSent == m_numItems;
+}
+
+csp::WorkResult::Enum csp::OpChannelOutMany::Evaluate( Host& host )
+{
+	Channel& channel = ThisChannel();
+
+	if( !HasArgumentsMoved() && !channel.IsClosed() )
+	{
+		while( !AllItemsSent() && channel.InAttached() && channel.IsBufferEmpty() )
+		{
+			ChannelAttachmentIn_i& in = channel.InAttachment();
+			Process& inputProcess = in.ProcessToEvaluate();
+			SendItem( in );
+			host.PushEvalStep( inputProcess );
+		}
+
+		if( !AllItemsSent() && channel.CanBufferMessage() )
+			SendItemsToBuffer();
+	}
+
+	if( HasArgumentsMoved() || AllItemsSent() || channel.IsClosed() )
+	{
+		channel.DetachOut( Waiter() );
+		UnrefChannel( host.LuaState().GetStack() );
+		return WorkResult::FINISH;
+	}
+
+	return WorkResult::YIELD;
+}
+
+void csp::OpChannelOutMany::SendItem( ChannelAttachmentIn_i& in )
+{
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+
+	stack.CheckStack( 1 );
+	stack.GetTopValue().PushRawGetIndex( ++m_numItemsSent );
+	in.MoveChannelArguments( ThisChannel(), stack, 1 );
+}
+
+void csp::OpChannelOutMany::SendItemsToBuffer()
+{
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	int arrayIndex = stack.GetTop();
+
+	int bufferIndex = Channel::PushBuffer( stack, ChannelRefKey() ).Index();
+	m_numItemsSent = PushItemsToBuffer( ThisChannel(), stack, bufferIndex, arrayIndex, m_numItemsSent, m_numItems );
+	stack.Pop( 1 );
+}
+
+void csp::OpChannelOutMany::CheckAllItemsSent( Host& host )
+{
+	if( !AllItemsSent() )
+		return;
+
+	ArgumentsMoved();
+	ThisChannel().DetachOut( Waiter() );
+	host.PushEvalStep( ThisProcess() );
+}
+
+csp::Process& csp::OpChannelOutMany::ProcessToEvaluate()
+{
+	return ThisProcess();
+}
+
+void csp::OpChannelOutMany::Communicate( Host& host, ChannelAttachmentIn_i& in )
+{
+	SendItem( in );
+	CheckAllItemsSent( host );
+}
+
+void csp::OpChannelOutMany::MoveToBuffer( Host& host )
+{
+	SendItemsToBuffer();
+	CheckAllItemsSent( host );
+}
+
+int csp::OpChannelOutMany::PushResults( lua::LuaStack& luaStack )
+{
+	// fewer items are sent if the channel is closed
+	luaStack.PushInteger( m_numItemsSent );
+	return 1;
+}
+
+void csp::OpChannelOutMany::Terminate( Host& host )
+{
+	ThisChannel().DetachOut( Waiter() );
+	OpChannel::Terminate( host );
+}
+
+void csp::OpChannelOutMany::CloseChannel( Host& host, Channel& channel )
+{
+	OpChannel::CloseChannel( host, channel );
+	channel.DetachOut( Waiter() );
+}
+
+
+csp::ChannelWaiter::ChannelWaiter()
+	: m_index( 0 )
+	, m_pAttachment()
+	, m_pQueue()
+	, m_pPrev()
+	, m_pNext()
+{
+}
+
+csp::ChannelWaiter::~ChannelWaiter()
+{
+	CORE_ASSERT( m_pQueue == NULL );
+}
+
+bool csp::ChannelWaiter::IsQueued() const
+{
+	return m_pQueue != NULL;
+}
+
+void csp::ChannelWaiter::SetIndex( int index )
+{
+	m_index = index;
+}
+
+int csp::ChannelWaiter::Index() const
+{
+	return m_index;
+}
+
+
+csp::ChannelWaitQueue::ChannelWaitQueue()
+	: m_pFirst()
+	, m_pLast()
+{
+}
+
+csp::ChannelWaitQueue::~ChannelWaitQueue()
+{
+	CORE_ASSERT( IsEmpty() );
+}
+
+void csp::ChannelWaitQueue::PushBack( ChannelWaiter& waiter, ChannelAttachment_i& attachment )
+{
+	CORE_ASSERT( waiter.m_pQueue == NULL );
+
+	waiter.m_pAttachment = &attachment;
+	waiter.m_pQueue = this;
+	waiter.m_pPrev = m_pLast;
+	waiter.m_pNext = NULL;
+
+	if( m_pLast )
+		m_pLast->m_pNext = &waiter;
+	else
+		m_pFirst = &waiter;
+	m_pLast = &waiter;
+}
+
+void csp::ChannelWaitQueue::Remove( ChannelWaiter& waiter )
+{
+	if( waiter.m_pQueue != this )
+		return;
+
+	if( waiter.m_pPrev )
+		waiter.m_pPrev->m_pNext = waiter.m_pNext;
+	else
+		m_pFirst = waiter.m_pNext;
+
+	if( waiter.m_pNext )
+		waiter.m_pNext->m_pPrev = waiter.m_pPrev;
+	else
+		m_pLast = waiter.m_pPrev;
+
+	waiter.m_pQueue = NULL;
+	waiter.m_pPrev = NULL;
+	waiter.m_pNext = NULL;
+}
+
+bool csp::ChannelWaitQueue::IsEmpty() const
+{
+	return m_pFirst == NULL;
+}
+
+csp::ChannelAttachment_i& csp::ChannelWaitQueue::Front() const
+{
+	CORE_ASSERT( m_pFirst );
+	return *m_pFirst->m_pAttachment;
+}
+
+csp::ChannelWaiter& csp::ChannelWaitQueue::FrontWaiter() const
+{
+	CORE_ASSERT( m_pFirst );
+	return *m_pFirst;
+}
+
+
+csp::Channel::Channel( int capacity )
+	: m_readers()
+	, m_writers()
 	, m_isClosed( false )
+	, m_capacity( capacity )
+	, m_messageSizes()
+	, m_firstMessage( 0 )
+	, m_numMessages( 0 )
+	, m_valueCapacity( 0 )
+	, m_firstValue( 0 )
+	, m_numValues( 0 )
 {
+	CORE_ASSERT( capacity >= 0 );
+	if( capacity > 0 )
+	{
+		m_messageSizes = CORE_NEW int[ capacity ];
+
+		// a power of two: value slots wrap around with a mask
+		m_valueCapacity = 1;
+		while( m_valueCapacity < capacity )
+			m_valueCapacity *= 2;
+	}
 }
 
 csp::Channel::~Channel()
 {
-	CORE_ASSERT( m_pAttachmentIn == NULL );
-	CORE_ASSERT( m_pAttachmentOut == NULL );
+	CORE_ASSERT( m_readers.IsEmpty() );
+	CORE_ASSERT( m_writers.IsEmpty() );
+
+	delete[] m_messageSizes;
+	m_messageSizes = NULL;
 }
 
-void csp::Channel::SetAttachmentIn( ChannelAttachmentIn_i& attachment )
+void csp::Channel::AttachIn( ChannelWaiter& waiter, ChannelAttachmentIn_i& attachment )
 {
-	m_pAttachmentIn = &attachment;
+	m_readers.PushBack( waiter, attachment );
 }
 
-void csp::Channel::SetAttachmentOut( ChannelAttachmentOut_i& attachment )
+void csp::Channel::AttachOut( ChannelWaiter& waiter, ChannelAttachmentOut_i& attachment )
 {
-	m_pAttachmentOut = &attachment;
+	m_writers.PushBack( waiter, attachment );
 }
 
-void csp::Channel::ResetAttachmentIn( const ChannelAttachmentIn_i& attachment )
+void csp::Channel::DetachIn( ChannelWaiter& waiter )
 {
-	if( m_pAttachmentIn == &attachment )
-		m_pAttachmentIn = NULL;
+	m_readers.Remove( waiter );
 }
 
-void csp::Channel::ResetAttachmentOut( const ChannelAttachmentOut_i& attachment )
+void csp::Channel::DetachOut( ChannelWaiter& waiter )
 {
-	if( m_pAttachmentOut == &attachment )
-		m_pAttachmentOut = NULL;
+	m_writers.Remove( waiter );
 }
 
 bool csp::Channel::InAttached() const
 {
-	return m_pAttachmentIn != NULL;
+	return !m_readers.IsEmpty();
 }
 
 bool csp::Channel::OutAttached() const
 {
-	return m_pAttachmentOut != NULL;
+	return !m_writers.IsEmpty();
 }
 
 csp::ChannelAttachmentIn_i& csp::Channel::InAttachment() const
 {
-	CORE_ASSERT( m_pAttachmentIn );
-	return *m_pAttachmentIn;
+	// only readers are queued in m_readers
+	return static_cast< ChannelAttachmentIn_i& >( m_readers.Front() );
 }
 
 csp::ChannelAttachmentOut_i& csp::Channel::OutAttachment() const
 {
-	CORE_ASSERT( m_pAttachmentOut );
-	return *m_pAttachmentOut;
+	return static_cast< ChannelAttachmentOut_i& >( m_writers.Front() );
+}
+
+csp::ChannelWaiter& csp::Channel::InWaiter() const
+{
+	return m_readers.FrontWaiter();
 }
 
 bool csp::Channel::IsClosed() const
@@ -426,35 +1121,378 @@ void csp::Channel::Close( Host& host )
 {
 	m_isClosed = true;
 
-	if( InAttached() )
+	// readers which haven't drained the buffer yet will get the buffered messages first.
+	// CloseChannel detaches the waiter, so the queues shrink to empty.
+	while( InAttached() && IsBufferEmpty() )
 	{
 		host.PushEvalStep( InAttachment().ProcessToEvaluate() );
 		InAttachment().CloseChannel( host, *this );
 	}
-	if( OutAttached() )
+	while( OutAttached() )
 	{
 		host.PushEvalStep( OutAttachment().ProcessToEvaluate() );
 		OutAttachment().CloseChannel( host, *this );
 	}
 }
 
+bool csp::Channel::IsBuffered() const
+{
+	return m_capacity > 0;
+}
+
+bool csp::Channel::IsBufferEmpty() const
+{
+	return m_numMessages == 0;
+}
+
+bool csp::Channel::IsBufferFull() const
+{
+	return m_numMessages == m_capacity;
+}
+
+bool csp::Channel::CanBufferMessage() const
+{
+	if( !IsBuffered() || IsBufferFull() || IsClosed() )
+		return false;
+
+	// a waiting reader is attached to an empty buffer only: rendezvous with it
+	return !( InAttached() && IsBufferEmpty() );
+}
+
+int csp::Channel::NumBufferedMessages() const
+{
+	return m_numMessages;
+}
+
+int csp::Channel::BufferRoom() const
+{
+	return m_capacity - m_numMessages;
+}
+
+int csp::Channel::InitialBufferSize() const
+{
+	return m_valueCapacity;
+}
+
+lua::LuaStackValue csp::Channel::PushBuffer( lua::LuaStack& stack, lua::LuaRef_t channelRefKey )
+{
+	stack.CheckStack( 2 );
+	stack.PushRegistryReferenced( channelRefKey );
+	PushBuffer( stack.GetTopValue() );
+	stack.Remove( stack.GetTop() - 1 );
+	return stack.GetTopValue();
+}
+
+lua::LuaStackValue csp::Channel::PushBuffer( lua::LuaStackValue const& channelValue )
+{
+	return channelValue.PushUserValue();
+}
+
+int csp::Channel::ValueSlot( int offset ) const
+{
+	return ( ( m_firstValue + offset ) & ( m_valueCapacity - 1 ) ) + 1;
+}
+
+void csp::Channel::PushMessage( lua::LuaStack& stack, int bufferIndex, int numValues )
+{
+	CORE_ASSERT( IsBuffered() && !IsBufferFull() );
+
+	stack.CheckStack( 2 );
+	if( m_numValues + numValues > m_valueCapacity )
+		GrowValues( stack, bufferIndex, m_numValues + numValues );
+
+	lua::LuaStackValue buffer = stack[ bufferIndex ];
+	for( int i = numValues-1; i >= 0; --i )
+		buffer.RawSetIndex( ValueSlot( m_numValues + i ) );
+	m_numValues += numValues;
+
+	m_messageSizes[ ( m_firstMessage + m_numMessages ) % m_capacity ] = numValues;
+	++m_numMessages;
+}
+
+int csp::Channel::PopMessage( Host& host, lua::LuaStack& stack, int bufferIndex )
+{
+	CORE_ASSERT( !IsBufferEmpty() );
+
+	int numValues = m_messageSizes[ m_firstMessage ];
+	m_firstMessage = ( m_firstMessage + 1 ) % m_capacity;
+	--m_numMessages;
+
+	stack.CheckStack( numValues + 1 );
+	lua::LuaStackValue buffer = stack[ bufferIndex ];
+	for( int i = 0; i < numValues; ++i )
+	{
+		int slot = ValueSlot( i );
+		buffer.PushRawGetIndex( slot );
+		// drop the reference: the buffer mustn't keep received values alive
+		stack.PushNil();
+		buffer.RawSetIndex( slot );
+	}
+
+	m_numValues -= numValues;
+	m_firstValue = m_numValues > 0 ? ( m_firstValue + numValues ) & ( m_valueCapacity - 1 ) : 0;
+
+	if( OutAttached() )
+		OutAttachment().MoveToBuffer( host );
+
+	return numValues;
+}
+
+void csp::Channel::GrowValues( lua::LuaStack& stack, int bufferIndex, int numValuesRequired )
+{
+	int oldCapacity = m_valueCapacity;
+	while( m_valueCapacity < numValuesRequired )
+		m_valueCapacity *= 2;
+
+	// the wrapped part of the ring moves behind the old end, the buffer table stays the same
+	lua::LuaStackValue buffer = stack[ bufferIndex ];
+	int numWrapped = m_firstValue + m_numValues - oldCapacity;
+	for( int i = 0; i < numWrapped; ++i )
+	{
+		buffer.PushRawGetIndex( i + 1 );
+		buffer.RawSetIndex( oldCapacity + i + 1 );
+		stack.PushNil();
+		buffer.RawSetIndex( i + 1 );
+	}
+}
+
 
 int csp::Channel_new( lua_State* luaState )
 {
-	csp::Channel* pChannel = CORE_NEW csp::Channel();
-	csp::PushChannel( luaState, *pChannel );
+	lua::LuaStack args( luaState );
+	// called as Channel:new( capacity )
+	lua::LuaStackValue capacityArg = args[2];
+	int capacity = capacityArg.OptInteger( 0 );
+	if( capacity < 0 )
+		return capacityArg.ArgError( "non-negative capacity expected" );
+
+	csp::Channel* pChannel = &csp::PushChannel( luaState, capacity );
+
+	if( pChannel->IsBuffered() )
+	{
+		lua::LuaStackValue channel = args.GetTopValue();
+		args.PushTable( pChannel->InitialBufferSize() );
+		channel.SetUserValue();
+	}
 	return 1;
 }
 
 int csp::Channel_IN( lua_State* luaState )
 {
-	OpChannelIn* pIn = CORE_NEW OpChannelIn();
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	// a buffered message is taken without an operation: the process doesn't yield
+	if( pChannel && !pChannel->IsBufferEmpty() && !pChannel->InAttached() )
+	{
+		int bufferIndex = channel.PushUserValue().Index();
+		return pChannel->PopMessage( Host::GetHost( luaState ), args, bufferIndex );
+	}
+
+	OpChannelIn* pIn = new( Host::GetHost( luaState ) ) OpChannelIn();
 	return pIn->DoInit( luaState );
 }
 
 int csp::Channel_OUT( lua_State* luaState )
 {
-	OpChannelOut* pOut = CORE_NEW OpChannelOut();
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	// while the buffer has room OUT completes at once
+	if( pChannel && pChannel->CanBufferMessage() && !pChannel->OutAttached() )
+	{
+		int numValues = args.NumArgs() - 1;
+		channel.PushUserValue();
+		args.Insert( 2 );
+		pChannel->PushMessage( args, 2, numValues );
+		return 0;
+	}
+
+	OpChannelOut* pOut = new( Host::GetHost( luaState ) ) OpChannelOut();
+	return pOut->DoInit( luaState );
+}
+
+int csp::Channel_IN_MANY( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	lua::LuaStackValue maxItemsArg = args[2];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	// buffered items are taken without an operation, a blocked writer refills the buffer meanwhile
+	if( pChannel && !pChannel->IsBufferEmpty() && !pChannel->InAttached()
+		&& maxItemsArg.IsNumber() && maxItemsArg.GetInteger() >= 1 )
+	{
+		int maxItems = maxItemsArg.GetInteger();
+		int numBuffered = pChannel->NumBufferedMessages();
+
+		int itemsIndex = args.PushTable( maxItems < numBuffered ? maxItems : numBuffered ).Index();
+		int bufferIndex = channel.PushUserValue().Index();
+		int numItems = PopItemsFromBuffer( Host::GetHost( luaState ), *pChannel, args, bufferIndex, itemsIndex, 0, maxItems );
+		args.Pop( 1 );
+
+		args.PushInteger( numItems );
+		return 2;
+	}
+
+	OpChannelInMany* pIn = new( Host::GetHost( luaState ) ) OpChannelInMany();
+	return pIn->DoInit( luaState );
+}
+
+int csp::Channel_OUT_MANY( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	lua::LuaStackValue array = args[2];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	// the whole array fits into the buffer: OUT_MANY completes at once
+	if( pChannel && array.IsTable() && pChannel->CanBufferMessage() && !pChannel->OutAttached()
+		&& (int)array.RawLength() <= pChannel->BufferRoom() )
+	{
+		int numItems = (int)array.RawLength();
+		int bufferIndex = channel.PushUserValue().Index();
+		PushItemsToBuffer( *pChannel, args, bufferIndex, array.Index(), 0, numItems );
+
+		args.PushInteger( numItems );
+		return 1;
+	}
+
+	OpChannelOutMany* pOut = new( Host::GetHost( luaState ) ) OpChannelOutMany();
+	return pOut->DoInit( luaState );
+}
+
+int csp::Channel_TRY_IN( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+	if( pChannel == NULL )
+		return channel.ArgError( "Channel expected." );
+
+	// readers waiting already are served first
+	if( pChannel->InAttached() )
+	{
+		args.PushBoolean( false );
+		return 1;
+	}
+
+	if( !pChannel->IsBufferEmpty() )
+	{
+		int bufferIndex = channel.PushUserValue().Index();
+		args.PushBoolean( true );
+		int numValues = pChannel->PopMessage( Host::GetHost( luaState ), args, bufferIndex );
+		return 1 + numValues;
+	}
+
+	if( pChannel->IsClosed() )
+	{
+		args.PushNil();
+		return 1;
+	}
+
+	if( !pChannel->OutAttached() )
+	{
+		args.PushBoolean( false );
+		return 1;
+	}
+
+	args.CheckStack( 1 );
+	args.PushBoolean( true );
+
+	ChannelAttachmentOut_i& out = pChannel->OutAttachment();
+	TryInAttachment in( args );
+	out.Communicate( Host::GetHost( luaState ), in );
+	CORE_ASSERT( in.NumArguments() != CSP_NO_ARGS );
+
+	return 1 + in.NumArguments();
+}
+
+int csp::Channel_TRY_OUT( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+	if( pChannel == NULL )
+		return channel.ArgError( "Channel expected." );
+
+	int numValues = args.NumArgs() - 1;
+
+	if( pChannel->IsClosed() )
+	{
+		args.PushNil();
+		return 1;
+	}
+
+	// writers waiting already are served first
+	if( pChannel->OutAttached() )
+	{
+		args.PushBoolean( false );
+		return 1;
+	}
+
+	if( pChannel->CanBufferMessage() )
+	{
+		channel.PushUserValue();
+		args.Insert( 2 );
+		pChannel->PushMessage( args, 2, numValues );
+
+		args.PushBoolean( true );
+		return 1;
+	}
+
+	if( !pChannel->InAttached() || !pChannel->IsBufferEmpty() )
+	{
+		args.PushBoolean( false );
+		return 1;
+	}
+
+	ChannelAttachmentIn_i& in = pChannel->InAttachment();
+	Process& inputProcess = in.ProcessToEvaluate();
+	in.MoveChannelArguments( *pChannel, args, numValues );
+
+	Host::GetHost( luaState ).PushEvalStep( inputProcess );
+
+	args.PushBoolean( true );
+	return 1;
+}
+
+int csp::Channel_IN_TIMEOUT( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	if( pChannel && !pChannel->IsBufferEmpty() && !pChannel->InAttached() && args[2].IsNumber() )
+	{
+		int bufferIndex = channel.PushUserValue().Index();
+		return pChannel->PopMessage( Host::GetHost( luaState ), args, bufferIndex );
+	}
+
+	OpChannelInTimeout* pIn = new( Host::GetHost( luaState ) ) OpChannelInTimeout();
+	return pIn->DoInit( luaState );
+}
+
+int csp::Channel_OUT_TIMEOUT( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	if( pChannel && pChannel->CanBufferMessage() && !pChannel->OutAttached() && args[2].IsNumber() )
+	{
+		int numValues = args.NumArgs() - 2;
+		channel.PushUserValue();
+		args.Insert( 3 );
+		pChannel->PushMessage( args, 3, numValues );
+
+		args.PushBoolean( true );
+		return 1;
+	}
+
+	OpChannelOutTimeout* pOut = new( Host::GetHost( luaState ) ) OpChannelOutTimeout();
 	return pOut->DoInit( luaState );
 }
 
@@ -473,7 +1511,18 @@ int csp::Channel_RANGE( lua_State* luaState )
 
 int csp::RANGE_next( lua_State* luaState )
 {
-	OpChannelRange* pRange = CORE_NEW OpChannelRange();
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue channel = args[1];
+	Channel* pChannel = IsChannelArg( channel ) ? GetChannelArg( channel ) : NULL;
+
+	if( pChannel && !pChannel->IsBufferEmpty() && !pChannel->InAttached() )
+	{
+		int bufferIndex = channel.PushUserValue().Index();
+		args.PushBoolean( true );
+		return 1 + pChannel->PopMessage( Host::GetHost( luaState ), args, bufferIndex );
+	}
+
+	OpChannelRange* pRange = new( Host::GetHost( luaState ) ) OpChannelRange();
 	return pRange->DoInit( luaState );
 }
 
@@ -493,24 +1542,19 @@ int csp::Channel_close( lua_State* luaState )
 	return 0;
 }
 
-void csp::PushChannel( lua_State* luaState, Channel& ch )
+csp::Channel& csp::PushChannel( lua_State* luaState, int capacity )
 {
-	PushGcObject( luaState, ch, channelFunctions );
+	return *new( PushGcObjectMemory( luaState, sizeof( Channel ), channelFunctions ) ) Channel( capacity );
 }
 
 bool csp::IsChannelArg( lua::LuaStackValue const& value )
 {
-	return value.IsUserData(); // TODO: add more checks.
+	return IsGcObject( value, channelFunctions );
 }
 
 csp::Channel* csp::GetChannelArg( lua::LuaStackValue const& value )
 {
-	if( !value.IsUserData() )
-		return NULL;
-
-	GcObject** pGcObject = (GcObject**)value.GetUserData();
-	Channel* pChannel = static_cast< Channel* >( *pGcObject ); // TODO: add more type checks.
-	return pChannel;
+	return static_cast< Channel* >( GetGcObject( value, channelFunctions ) );
 }
 
 
@@ -21,7 +21,6 @@ namespace csp
 {
 	struct ChannelAttachmentIn_i;
 	struct ChannelAttachmentOut_i;
-	struct ChannelArgument;
 
 	class GcObject;
 	class Channel;
@@ -29,38 +28,115 @@ namespace csp
 
 namespace csp
 {
-	struct ChannelArgument
+	const int CSP_NO_ARGS = -1;
+
+	class ChannelWaitQueue;
+
+	// Intrusive node of a channel wait queue. An ALT waits on several channels at once: it has a waiter per case,
+	// and the index tells which case the channel serves.
+	class ChannelWaiter
 	{
-		lua::LuaRef_t refKey;
+	public:
+		ChannelWaiter();
+		~ChannelWaiter();
+
+		bool IsQueued() const;
+
+		void SetIndex( int index );
+		int Index() const;
+
+	private:
+		friend class ChannelWaitQueue;
+
+		int m_index;
+		ChannelAttachment_i* m_pAttachment;
+		ChannelWaitQueue* m_pQueue;
+		ChannelWaiter* m_pPrev;
+		ChannelWaiter* m_pNext;
 	};
 
-	const int CSP_NO_ARGS = -1;
+	// FIFO of the operations engaged on one end of a channel. Push, pop and removal from the middle are O(1).
+	class ChannelWaitQueue
+	{
+	public:
+		ChannelWaitQueue();
+		~ChannelWaitQueue();
 
+		void PushBack( ChannelWaiter& waiter, ChannelAttachment_i& attachment );
+		void Remove( ChannelWaiter& waiter );
+
+		bool IsEmpty() const;
+		ChannelAttachment_i& Front() const;
+		ChannelWaiter& FrontWaiter() const;
+
+	private:
+		ChannelWaiter* m_pFirst;
+		ChannelWaiter* m_pLast;
+	};
+
+	// Buffered channels keep up to capacity messages. The values wait in a ring of slots of a Lua table
+	// which is the uservalue of the channel userdata, so the GC sees them and no registry slot is spent.
 	class Channel : public GcObject
 	{
 	public:
-		Channel();
+		explicit Channel( int capacity = 0 );
 		virtual ~Channel();
 
-		void SetAttachmentIn( ChannelAttachmentIn_i& attachment );
-		void SetAttachmentOut( ChannelAttachmentOut_i& attachment );
+		// Any number of readers and writers queue up, the longest waiting one is served first.
+		void AttachIn( ChannelWaiter& waiter, ChannelAttachmentIn_i& attachment );
+		void AttachOut( ChannelWaiter& waiter, ChannelAttachmentOut_i& attachment );
 	
-		void ResetAttachmentIn( const ChannelAttachmentIn_i& attachment );
-		void ResetAttachmentOut( const ChannelAttachmentOut_i& attachment );
+		void DetachIn( ChannelWaiter& waiter );
+		void DetachOut( ChannelWaiter& waiter );
 
 		bool InAttached() const;
 		bool OutAttached() const;
 
 		ChannelAttachmentIn_i& InAttachment() const;
 		ChannelAttachmentOut_i& OutAttachment() const;
+		// The reader served next: writers always hand their values to it.
+		ChannelWaiter& InWaiter() const;
 
 		void Close( Host& host );
 		bool IsClosed() const;
 
+		bool IsBuffered() const;
+		bool IsBufferEmpty() const;
+		bool IsBufferFull() const;
+		int NumBufferedMessages() const;
+		int BufferRoom() const;
+		// A writer may leave its values in the buffer unless a reader is waiting for them directly.
+		bool CanBufferMessage() const;
+
+		int InitialBufferSize() const;
+		static lua::LuaStackValue PushBuffer( lua::LuaStack& stack, lua::LuaRef_t channelRefKey );
+		static lua::LuaStackValue PushBuffer( lua::LuaStackValue const& channelValue );
+
+		// Moves the top numValues values of stack to the buffer table at bufferIndex.
+		void PushMessage( lua::LuaStack& stack, int bufferIndex, int numValues );
+		// Pushes the oldest message from the buffer table at bufferIndex, returns the number of values.
+		// A writer blocked on the full buffer takes the freed place.
+		int PopMessage( Host& host, lua::LuaStack& stack, int bufferIndex );
+
 	private:
-		ChannelAttachmentIn_i* m_pAttachmentIn;
-		ChannelAttachmentOut_i* m_pAttachmentOut;
+		Channel( const Channel& );
+		Channel& operator=( const Channel& );
+
+		void GrowValues( lua::LuaStack& stack, int bufferIndex, int numValues );
+		int ValueSlot( int offset ) const;
+
+		ChannelWaitQueue m_readers;
+		ChannelWaitQueue m_writers;
 		bool m_isClosed;
+
+		int m_capacity;
+		int* m_messageSizes;
+		int m_firstMessage;
+		int m_numMessages;
+
+		int m_valueCapacity;
+		int m_firstValue;
+		int m_numValues;
 	};
 
 	class OpChannel : public Operation
@@ -70,23 +146,31 @@ namespace csp
 		virtual ~OpChannel();
 
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 
 	protected:
-		void Communicate( Host& host, Process& inputProcess );
+		// The reader pulls the values while it's evaluated and finishes right away: only the writer is woken up.
+		void Communicate( Host& host, ChannelAttachmentIn_i& in );
+		// The writer hands the values to a waiting reader while it's evaluated: the reader resumes at once.
+		void HandOff( Host& host, ChannelAttachmentIn_i& in );
 
 		bool InitChannel( lua::LuaStack& args, InitError& initError );
 		void UnrefChannel( lua::LuaStack const& stack );
 
+		// Arguments aren't referenced: they stay on top of the suspended thread stack
+		// and travel to the reader with lua_xmove.
 		void InitArguments( lua::LuaStack& args, InitError& initError );
-		void SetArguments( ChannelArgument* arguments, int numArguments );
-		void UnrefArguments( lua::LuaStack const& stack );
+		void SetArguments( int numArguments );
 
 		bool HasChannel();
 		Channel& ThisChannel();
+		ChannelWaiter& Waiter();
+		lua::LuaRef_t ChannelRefKey() const;
 
-		void MoveChannelArguments( ChannelArgument* arguments, int numArguments );
+		void MoveChannelArguments( lua::LuaStack& fromStack, int numArguments );
+		void MoveArgumentsToBuffer( Host& host );
+		bool ReceiveFromBuffer( Host& host );
 		void ArgumentsMoved();		
-		ChannelArgument* Arguments() const;
 		int NumArguments() const;
 		bool HasArgumentsMoved() const;
 		bool HasArguments() const;
@@ -97,8 +181,8 @@ namespace csp
 	private:
 		lua::LuaRef_t m_channelRefKey;
 		Channel* m_pChannel;
+		ChannelWaiter m_waiter;
 
-		ChannelArgument* m_arguments;
 		int m_numArguments;
 		bool m_argumentsMoved;
 	};
@@ -110,15 +194,14 @@ namespace csp
 		virtual ~OpChannelIn();
 
 	protected:
-		virtual int PushResults( lua::LuaStack& luaStack );
-
-	private:
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual int PushResults( lua::LuaStack& luaStack );
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual void Terminate( Host& host );
-		
+
+	private:
 		virtual Process& ProcessToEvaluate();
-		virtual void MoveChannelArguments( Channel& channel, ChannelArgument* arguments, int numArguments );
+		virtual void MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments );
 		virtual void CloseChannel( Host& host, Channel& channel );
 	};
 
@@ -128,14 +211,59 @@ namespace csp
 		OpChannelOut();
 		virtual ~OpChannelOut();
 
-	private:
+	protected:
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual void Terminate( Host& host );
+		virtual void CloseChannel( Host& host, Channel& channel );
+
+	private:
+		virtual int NumRetainedValues() const;
 
 		virtual Process& ProcessToEvaluate();
-		virtual void Communicate( Host& host, Process& inputProcess );
+		virtual void Communicate( Host& host, ChannelAttachmentIn_i& in );
+		virtual void MoveToBuffer( Host& host );
+	};
+
+	// IN_TIMEOUT( seconds ) and OUT_TIMEOUT( seconds, ... ) give up once the host timer queue expires
+	// their single deadline: the caller gets nil, "timeout" and the channel is left as it was.
+	// A close gives nil, "closed" instead.
+	class OpChannelInTimeout : public OpChannelIn, TimerAttachment_i
+	{
+	public:
+		OpChannelInTimeout();
+		virtual ~OpChannelInTimeout();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual int PushResults( lua::LuaStack& luaStack );
+		virtual void Terminate( Host& host );
+
+		virtual void ExpireTimer( Host& host );
+
+		Timer m_timer;
+		bool m_timedOut;
+	};
+
+	class OpChannelOutTimeout : public OpChannelOut, TimerAttachment_i
+	{
+	public:
+		OpChannelOutTimeout();
+		virtual ~OpChannelOutTimeout();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual int PushResults( lua::LuaStack& luaStack );
+		virtual void Terminate( Host& host );
 		virtual void CloseChannel( Host& host, Channel& channel );
+
+		virtual void ExpireTimer( Host& host );
+
+		Timer m_timer;
+		bool m_timedOut;
+		bool m_closed;
 	};
 
 	class OpChannelRange : public OpChannelIn
@@ -148,7 +276,61 @@ namespace csp
 		virtual int PushResults( lua::LuaStack& luaStack );
 	};
 
-	void PushChannel( lua_State* luaState, Channel& channel );
+	// Batched transfer: every item is a single value message. IN_MANY keeps the first value of a message.
+	// The items table waits on top of the suspended process stack.
+	class OpChannelInMany : public OpChannel, ChannelAttachmentIn_i
+	{
+	public:
+		OpChannelInMany();
+		virtual ~OpChannelInMany();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual int NumRetainedValues() const;
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual int PushResults( lua::LuaStack& luaStack );
+		virtual void Terminate( Host& host );
+
+		virtual Process& ProcessToEvaluate();
+		virtual void MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments );
+		virtual void CloseChannel( Host& host, Channel& channel );
+
+		bool IsFull() const;
+
+		int m_maxItems;
+		int m_numItems;
+	};
+
+	// A writer stays in the channel queue until all the items are taken, so one rendezvous
+	// serves every waiting reader. The array waits on top of the suspended process stack.
+	class OpChannelOutMany : public OpChannel, ChannelAttachmentOut_i
+	{
+	public:
+		OpChannelOutMany();
+		virtual ~OpChannelOutMany();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual int NumRetainedValues() const;
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual int PushResults( lua::LuaStack& luaStack );
+		virtual void Terminate( Host& host );
+
+		virtual Process& ProcessToEvaluate();
+		virtual void Communicate( Host& host, ChannelAttachmentIn_i& in );
+		virtual void MoveToBuffer( Host& host );
+		virtual void CloseChannel( Host& host, Channel& channel );
+
+		void SendItem( ChannelAttachmentIn_i& in );
+		void SendItemsToBuffer();
+		bool AllItemsSent() const;
+		void CheckAllItemsSent( Host& host );
+
+		int m_numItems;
+		int m_numItemsSent;
+	};
+
+	Channel& PushChannel( lua_State* luaState, int capacity = 0 );
 	bool IsChannelArg( lua::LuaStackValue const& value );
 	Channel* GetChannelArg( lua::LuaStackValue const& value );
 
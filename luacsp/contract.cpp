@@ -16,6 +16,8 @@ namespace csp
 {
 	int Contract_table( lua_State* luaState );
 	int Contract_new( lua_State* luaState );
+	int Contract_recycle( lua_State* luaState );
+	int ContractInstance_index( lua_State* luaState );
 
 	const csp::FunctionRegistration contractGlobals[] =
 	{
@@ -26,45 +28,161 @@ namespace csp
 	const csp::FunctionRegistration contractFunctions[] =
 	{
 		"new", csp::Contract_new
+		, "recycle", csp::Contract_recycle
 		, NULL, NULL
 	};
+
+	// light userdata keys of the fields hidden in the contract metatables.
+	// Not const: equal constants may be folded into one address, and the keys must stay distinct.
+	static char instanceMetatableKey = 0;
+	static char contractKey = 0;
+	static char poolKey = 0;
+
+	// short-lived conversations reuse up to that many instances of each contract
+	static const int CONTRACT_POOL_SIZE = 32;
+
+	static bool PushInstanceMetatable( lua::LuaStack& stack, lua::LuaStackValue const& contract )
+	{
+		if( !contract.IsTable() || !stack.GetMetaTable( contract ) )
+			return false;
+
+		lua::LuaStackValue metatable = stack.GetTopValue();
+		metatable.PushRawGetPointer( &instanceMetatableKey );
+		stack.Remove( metatable.Index() );
+
+		if( stack.GetTopValue().IsTable() )
+			return true;
+
+		stack.Pop( 1 );
+		return false;
+	}
+
+	static bool IsChannelIdle( Channel const& channel )
+	{
+		return !channel.IsClosed() && !channel.InAttached() && !channel.OutAttached()
+			&& ( !channel.IsBuffered() || channel.IsBufferEmpty() );
+	}
 }
 
 int csp::Contract_table( lua_State* luaState )
 {
 	lua::LuaStack stack( luaState );
-	stack.PushTable();
-	CspSetMetatable( luaState, stack.GetTopValue(), contractFunctions );
+	lua::LuaStackValue contract = stack.PushTable();
+
+	// Each contract has its own metatable to keep the metatable of its instances
+	// and the pool of recycled instances.
+	lua::LuaStackValue metatable = stack.PushTable();
+	PushCspMetatable( luaState, contractFunctions );
+	stack.SetField( metatable, "__index" );
+
+	lua::LuaStackValue instanceMetatable = stack.PushTable();
+	stack.PushCFunction( ContractInstance_index );
+	stack.SetField( instanceMetatable, "__index" );
+	contract.PushValue();
+	instanceMetatable.RawSetPointer( &contractKey );
+	stack.PushTable( CONTRACT_POOL_SIZE );
+	instanceMetatable.RawSetPointer( &poolKey );
+
+	metatable.RawSetPointer( &instanceMetatableKey );
+	stack.SetMetaTable( contract );
 	return 1;
 }
 
 int csp::Contract_new( lua_State* luaState )
 {
 	lua::LuaStack stack( luaState );
-	lua::LuaStackValue table = stack[1];
-	if( !table.IsTable() )
-		return table.ArgError( "contract table expected." );
+	lua::LuaStackValue contract = stack[1];
+	if( !PushInstanceMetatable( stack, contract ) )
+		return contract.ArgError( "contract table expected." );
 
-	lua::LuaStackValue contractInstance = stack.PushTable();
+	lua::LuaStackValue instanceMetatable = stack.GetTopValue();
 
-	for ( lua::LuaStackTableIterator it( table ); it; it.Next() )
+	lua::LuaStackValue pool = instanceMetatable.PushRawGetPointer( &poolKey );
+	int poolSize = (int)pool.RawLength();
+	if( poolSize > 0 )
 	{
-		lua::LuaStackValue channelName = it.Key();
-		lua::LuaStackValue value = it.Value();
-
-		if( !channelName.IsString() )
-			return stack.ArgError( 1, "channel name must be a string." );
-		if( !value.IsTable() )
-			return stack.ArgError( 1, "channel name must refer to Channel table." );
+		pool.PushRawGetIndex( poolSize );
+		stack.PushNil();
+		pool.RawSetIndex( poolSize );
+		return 1;
+	}
 
-		channelName.PushValue();
+	// the channels are created on the first access
+	lua::LuaStackValue contractInstance = stack.PushTable();
+	instanceMetatable.PushValue();
+	stack.SetMetaTable( contractInstance );
+	return 1;
+}
 
-		Channel* pChannel = CORE_NEW Channel();
-		PushChannel( luaState, *pChannel );
+int csp::Contract_recycle( lua_State* luaState )
+{
+	lua::LuaStack stack( luaState );
+	lua::LuaStackValue contract = stack[1];
+	lua::LuaStackValue contractInstance = stack[2];
+	if( !PushInstanceMetatable( stack, contract ) )
+		return contract.ArgError( "contract table expected." );
+
+	lua::LuaStackValue instanceMetatable = stack.GetTopValue();
+	if( !contractInstance.IsTable() || !stack.GetMetaTable( contractInstance ) )
+		return contractInstance.ArgError( "contract instance expected." );
+	if( !stack.GetTopValue().IsEqualByRef( instanceMetatable ) )
+		return contractInstance.ArgError( "instance of this contract expected." );
+	stack.Pop( 1 );
+
+	// Channels still in use stay with their processes, the instance gets new ones on the next access.
+	for ( lua::LuaStackTableIterator it( contractInstance ); it; it.Next() )
+	{
+		Channel* pChannel = GetChannelArg( it.Value() );
+		if( pChannel != NULL && IsChannelIdle( *pChannel ) )
+			continue;
 
+		it.Key().PushValue();
+		stack.PushNil();
 		stack.RawSet( contractInstance );
 	}
 
+	lua::LuaStackValue pool = instanceMetatable.PushRawGetPointer( &poolKey );
+	int poolSize = (int)pool.RawLength();
+	if( poolSize >= CONTRACT_POOL_SIZE )
+		return 0;
+
+	for( int i = 1; i <= poolSize; ++i )
+	{
+		bool isPooled = pool.PushRawGetIndex( i ).IsEqualByRef( contractInstance );
+		stack.Pop( 1 );
+		if( isPooled )
+			return 0;
+	}
+
+	contractInstance.PushValue();
+	pool.RawSetIndex( poolSize + 1 );
+	return 0;
+}
+
+int csp::ContractInstance_index( lua_State* luaState )
+{
+	lua::LuaStack stack( luaState );
+	lua::LuaStackValue contractInstance = stack[1];
+	lua::LuaStackValue channelName = stack[2];
+
+	stack.GetMetaTable( contractInstance );
+	lua::LuaStackValue contract = stack.GetTopValue().PushRawGetPointer( &contractKey );
+
+	channelName.PushValue();
+	lua::LuaStackValue value = stack.RawGet( contract );
+	if( value.IsNil() )
+		return 1;
+
+	if( !channelName.IsString() )
+		return stack.Error( "channel name must be a string." );
+	if( !value.IsTable() )
+		return stack.Error( "channel name must refer to Channel table." );
+
+	PushChannel( luaState );
+	lua::LuaStackValue channel = stack.GetTopValue();
+	channelName.PushValue();
+	channel.PushValue();
+	stack.RawSet( contractInstance );
 	return 1;
 }
 
@@ -0,0 +1,101 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "coroutinepool.h"
+
+#include "host.h"
+#include "process.h"
+
+csp::CoroutinePool::CoroutinePool( lua::LuaState& luaState, HostStats& stats )
+	: m_luaState( luaState )
+	, m_stats( stats )
+	, m_threads()
+	, m_numThreads( 0 )
+{
+}
+
+csp::CoroutinePool::~CoroutinePool()
+{
+	CORE_ASSERT( m_numThreads == 0 );
+}
+
+lua::LuaState csp::CoroutinePool::Acquire( Process& process, lua::LuaRef_t& refKey )
+{
+	CORE_ASSERT( refKey == lua::LUA_NO_REF );
+
+	lua::LuaState thread;
+	if( m_numThreads > 0 )
+	{
+		PooledThread& pooled = m_threads[ --m_numThreads ];
+		thread = lua::LuaState( pooled.pThread );
+		refKey = pooled.refKey;
+		++m_stats.numThreadPoolHits;
+	}
+	else
+	{
+		lua::LuaStack& stack = m_luaState.GetStack();
+		thread = stack.NewThread();
+		refKey = stack.RefInRegistry();
+		++m_stats.numThreadPoolMisses;
+	}
+
+	process.SetLuaThread( thread );
+	return thread;
+}
+
+void csp::CoroutinePool::Release( Process& process, lua::LuaRef_t& refKey )
+{
+	if( refKey == lua::LUA_NO_REF )
+		return;
+
+	lua::LuaState thread = process.LuaThread();
+	process.DetachLuaThread();
+
+	if( m_numThreads < COROUTINE_POOL_CAPACITY && IsReusable( thread ) )
+	{
+		lua::LuaStack& threadStack = thread.GetStack();
+		threadStack.Pop( threadStack.GetTop() );
+		thread.SetCountHook( NULL, 0 );
+		Process::SetProcess( thread.InternalState(), NULL );
+
+		PooledThread& pooled = m_threads[ m_numThreads++ ];
+		pooled.pThread = thread.InternalState();
+		pooled.refKey = refKey;
+
+		refKey = lua::LUA_NO_REF;
+	}
+	else
+	{
+		++m_stats.numThreadPoolDiscards;
+		Unref( refKey );
+	}
+}
+
+bool csp::CoroutinePool::IsReusable( lua::LuaState& thread ) const
+{
+	// Lua 5.2 can't reset a suspended coroutine or one which died with an error.
+	return thread.InternalState() != NULL
+		&& thread.Status() == lua::Return::OK
+		&& thread.StackSize() <= COROUTINE_POOL_MAX_STACK_SIZE;
+}
+
+void csp::CoroutinePool::Clear()
+{
+	while( m_numThreads > 0 )
+		Unref( m_threads[ --m_numThreads ].refKey );
+}
+
+int csp::CoroutinePool::Size() const
+{
+	return m_numThreads;
+}
+
+void csp::CoroutinePool::Unref( lua::LuaRef_t& refKey )
+{
+	m_luaState.GetStack().UnrefInRegistry( refKey );
+	refKey = lua::LUA_NO_REF;
+}
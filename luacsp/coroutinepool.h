@@ -0,0 +1,60 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <luacpp/luastate.h>
+
+#include "csp.h"
+
+namespace csp
+{
+	class Process;
+	struct HostStats;
+
+	static const int COROUTINE_POOL_CAPACITY = 256;
+	// Threads whose stack grew beyond this (deep recursion, many locals) are not recycled.
+	static const int COROUTINE_POOL_MAX_STACK_SIZE = 256;
+
+	// Per-host cache of finished Lua threads for PAR, Swarm, ALT and test closures.
+	// A pooled thread keeps the registry reference it was created with, so reusing it
+	// costs neither a lua_State allocation nor a registry slot.
+	class CoroutinePool
+	{
+	public:
+		CoroutinePool( lua::LuaState& luaState, HostStats& stats );
+		~CoroutinePool();
+
+		// Binds a fresh or recycled thread to the process. refKey keeps the thread alive until Release.
+		lua::LuaState Acquire( Process& process, lua::LuaRef_t& refKey );
+		// Detaches the thread from the process. Only threads which returned normally are recycled,
+		// suspended (terminated) or failed threads and threads with a grown stack are left to the GC.
+		void Release( Process& process, lua::LuaRef_t& refKey );
+
+		void Clear();
+		int Size() const;
+
+	private:
+		CoroutinePool( const CoroutinePool& );
+		CoroutinePool& operator=( const CoroutinePool& );
+
+		bool IsReusable( lua::LuaState& thread ) const;
+		void Unref( lua::LuaRef_t& refKey );
+
+		struct PooledThread
+		{
+			lua_State* pThread;
+			lua::LuaRef_t refKey;
+		};
+
+		lua::LuaState& m_luaState;
+		HostStats& m_stats;
+
+		PooledThread m_threads[ COROUTINE_POOL_CAPACITY ];
+		int m_numThreads;
+	};
+}
@@ -35,18 +35,23 @@ csp::WorkResult::Enum csp::OpCppChannelOut::Evaluate( Host& host )
 	{
 		if( IsOutputReady() )
 		{
-			lua::LuaStack& stack = host.LuaState().GetStack();
-			MemorizeOutputArguments( stack );
-			ThisChannel().SetAttachmentOut( *this );
+			PrepareOutput();
+			ThisChannel().AttachOut( Waiter(), *this );
 		}
 	}
 
 	if( IsOutputAttached() )
 	{
-		if( channel.InAttached() )
+		if( channel.InAttached() && channel.IsBufferEmpty() )
 		{
 			ChannelAttachmentIn_i& in = channel.InAttachment();
-			Communicate( host, in.ProcessToEvaluate() );
+			Process& inputProcess = in.ProcessToEvaluate();
+			Communicate( host, in );
+			host.PushEvalStep( inputProcess );
+		}
+		else if( channel.CanBufferMessage() )
+		{
+			MoveToBuffer( host );
 		}
 	}
 
@@ -59,33 +64,36 @@ csp::WorkResult::Enum csp::OpCppChannelOut::Work( Host& host, CspTime_t dt )
 	if( result == WorkResult::FINISH )
 	{
 		if( IsOutputAttached() )
-			ThisChannel().ResetAttachmentOut( *this );
+			ThisChannel().DetachOut( Waiter() );
 		return result;
 	}
 
 	return Evaluate( host );
 }
 
+bool csp::OpCppChannelOut::RequiresWork() const
+{
+	return true;
+}
+
 void csp::OpCppChannelOut::MemorizeOutputArguments( lua::LuaStack& stack )
 {
+	// pushed only when a Lua reader or the buffer takes the output: then moved as OUT arguments are
+	ThisProcess().LuaThread().CheckStack();
 	int numArguments = PushOutputArguments( stack );
 
-	csp::ChannelArgument* arguments = CORE_NEW csp::ChannelArgument[ numArguments ];
-	for( int i = numArguments-1; i >= 0; --i )
-		arguments[ i ].refKey = stack.RefInRegistry();
-
-	SetArguments( arguments, numArguments );
+	SetArguments( numArguments );
 }
 
 int csp::OpCppChannelOut::PushResults( lua::LuaStack& luaStack )
 {
 	UnrefChannel( luaStack );
-	UnrefArguments( luaStack );
 	return 0;
 }
 
 void csp::OpCppChannelOut::Terminate( Host& host )
 {
+	ThisChannel().DetachOut( Waiter() );
 	OpChannel::Terminate( host );
 }
 
@@ -94,23 +102,47 @@ csp::Process& csp::OpCppChannelOut::ProcessToEvaluate()
 	return ThisProcess();
 }
 
-void csp::OpCppChannelOut::Communicate( Host& host, Process& inputProcess )
+void csp::OpCppChannelOut::Communicate( Host& host, ChannelAttachmentIn_i& in )
+{
+	CORE_ASSERT( IsOutputAttached() );
+	if( MoveOutputInPlace( in ) )
+	{
+		host.PushEvalStep( ThisProcess() );
+	}
+	else
+	{
+		MemorizeOutputArguments( ThisProcess().LuaThread().GetStack() );
+		OpChannel::Communicate( host, in );
+	}
+	ThisChannel().DetachOut( Waiter() );
+}
+
+void csp::OpCppChannelOut::MoveToBuffer( Host& host )
 {
 	CORE_ASSERT( IsOutputAttached() );
-	OpChannel::Communicate( host, inputProcess );
-	ThisChannel().ResetAttachmentOut( *this );
+	MemorizeOutputArguments( ThisProcess().LuaThread().GetStack() );
+	MoveArgumentsToBuffer( host );
+	ThisChannel().DetachOut( Waiter() );
 }
 
 void csp::OpCppChannelOut::CloseChannel( Host& host, Channel& channel )
 {
 	OpChannel::CloseChannel( host, channel );
-	channel.ResetAttachmentOut( *this );
+	channel.DetachOut( Waiter() );
+}
+
+void csp::OpCppChannelOut::PrepareOutput()
+{
+}
+
+bool csp::OpCppChannelOut::MoveOutputInPlace( ChannelAttachmentIn_i& )
+{
+	return false;
 }
 
 bool csp::OpCppChannelOut::IsOutputAttached()
 {
-	Channel& channel = ThisChannel();
-	return channel.OutAttached() && &channel.OutAttachment() == this;
+	return Waiter().IsQueued();
 }
 
 void csp::InitializeCppChannels( lua::LuaState& )
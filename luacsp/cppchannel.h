@@ -7,6 +7,8 @@
  */
 #pragma once
 
+#include <utility>
+
 #include "csp.h"
 
 #include <luacpp/luastackvalue.h>
@@ -15,6 +17,7 @@
 
 namespace csp
 {
+	// Base of C++ writers. The output is made Lua values only when a Lua reader or the channel buffer takes it.
 	class OpCppChannelOut : public OpChannel, ChannelAttachmentOut_i
 	{
 	protected:
@@ -23,26 +26,263 @@ namespace csp
 
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 
-	private:
 		bool IsOutputAttached();
 
+	private:
 		virtual WorkResult::Enum Evaluate( Host& host );
 
 		void MemorizeOutputArguments( lua::LuaStack &stack );
 
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 		virtual int PushResults( lua::LuaStack& luaStack );
 		virtual void Terminate( Host& host );
 
 		virtual Process& ProcessToEvaluate();
-		virtual void Communicate( Host& host, Process& inputProcess );
+		virtual void Communicate( Host& host, ChannelAttachmentIn_i& in );
+		virtual void MoveToBuffer( Host& host );
 		virtual void CloseChannel( Host& host, Channel& channel );
 
+		virtual void PrepareOutput();
+		virtual bool MoveOutputInPlace( ChannelAttachmentIn_i& in );
+
 		virtual WorkResult::Enum Update( CspTime_t dt ) = 0;
 		virtual bool IsOutputReady() const = 0;
 		virtual int PushOutputArguments( lua::LuaStack& luaStack ) = 0;
 	};
 
+	// Identifies a C++ payload type without RTTI.
+	template< typename T >
+	struct TypedChannel
+	{
+		static const void* PayloadType();
+	};
+
+	// C++ writer of T messages. A typed reader of the same T gets the payload moved in place,
+	// PushPayload converts it for Lua readers and buffered channels only.
+	template< typename T >
+	class OpTypedOut : public OpCppChannelOut
+	{
+	protected:
+		OpTypedOut();
+		virtual ~OpTypedOut();
+
+		// Called once IsOutputReady() holds.
+		virtual void TakeOutput( T& payload ) = 0;
+		virtual int PushPayload( lua::LuaStack& luaStack, const T& payload ) = 0;
+
+	private:
+		virtual void PrepareOutput();
+		virtual bool MoveOutputInPlace( ChannelAttachmentIn_i& in );
+		virtual int PushOutputArguments( lua::LuaStack& luaStack );
+
+		T m_payload;
+	};
+
+	// C++ reader of T messages. ReadPayload converts the values sent by Lua writers,
+	// a typed writer of the same T moves its payload in place.
+	template< typename T >
+	class OpTypedIn : public OpChannel, ChannelAttachmentIn_i
+	{
+	protected:
+		OpTypedIn();
+		virtual ~OpTypedIn();
+
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual int PushResults( lua::LuaStack& luaStack );
+
+		bool IsInputAttached();
+
+	private:
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
+		virtual void Terminate( Host& host );
+
+		virtual Process& ProcessToEvaluate();
+		virtual void MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments );
+		virtual bool MovePayload( Channel& channel, const void* payloadType, void* pPayload );
+		virtual void CloseChannel( Host& host, Channel& channel );
+
+		void ReadArguments();
+
+		virtual WorkResult::Enum Update( CspTime_t dt ) = 0;
+		virtual bool IsInputReady() const = 0;
+		virtual void ConsumeInput( T& payload ) = 0;
+		// The values are the top numValues of luaStack. Returns false to drop the message.
+		virtual bool ReadPayload( lua::LuaStack& luaStack, int numValues, T& payload ) = 0;
+
+		T m_payload;
+		bool m_hasPayload;
+	};
+
 	void InitializeCppChannels( lua::LuaState& state );
 	void ShutdownCppChannels( lua::LuaState& state );
+
+	template< typename T >
+	const void* TypedChannel< T >::PayloadType()
+	{
+		// not const: identical COMDAT folding may merge equal constants of different instantiations
+		static char payloadType = 0;
+		return &payloadType;
+	}
+
+	template< typename T >
+	OpTypedOut< T >::OpTypedOut()
+		: m_payload()
+	{
+	}
+
+	template< typename T >
+	OpTypedOut< T >::~OpTypedOut()
+	{
+	}
+
+	template< typename T >
+	void OpTypedOut< T >::PrepareOutput()
+	{
+		TakeOutput( m_payload );
+	}
+
+	template< typename T >
+	bool OpTypedOut< T >::MoveOutputInPlace( ChannelAttachmentIn_i& in )
+	{
+		return in.MovePayload( ThisChannel(), TypedChannel< T >::PayloadType(), &m_payload );
+	}
+
+	template< typename T >
+	int OpTypedOut< T >::PushOutputArguments( lua::LuaStack& luaStack )
+	{
+		return PushPayload( luaStack, m_payload );
+	}
+
+
+	template< typename T >
+	OpTypedIn< T >::OpTypedIn()
+		: m_payload()
+		, m_hasPayload( false )
+	{
+	}
+
+	template< typename T >
+	OpTypedIn< T >::~OpTypedIn()
+	{
+	}
+
+	template< typename T >
+	bool OpTypedIn< T >::Init( lua::LuaStack& args, InitError& initError )
+	{
+		if( !InitChannel( args, initError ) )
+			return false;
+
+		return true;
+	}
+
+	template< typename T >
+	WorkResult::Enum OpTypedIn< T >::Evaluate( Host& host )
+	{
+		Channel& channel = ThisChannel();
+
+		if( !m_hasPayload && !IsInputAttached() && IsInputReady() )
+		{
+			if( ReceiveFromBuffer( host ) )
+				ReadArguments();
+			else if( !channel.IsClosed() )
+				channel.AttachIn( Waiter(), *this );
+		}
+
+		if( IsInputAttached() && channel.OutAttached() )
+			channel.OutAttachment().Communicate( host, *this );
+
+		if( m_hasPayload )
+		{
+			m_hasPayload = false;
+			ConsumeInput( m_payload );
+		}
+
+		return WorkResult::YIELD;
+	}
+
+	template< typename T >
+	WorkResult::Enum OpTypedIn< T >::Work( Host& host, CspTime_t dt )
+	{
+		WorkResult::Enum result = Update( dt );
+		if( result == WorkResult::FINISH )
+		{
+			ThisChannel().DetachIn( Waiter() );
+			return result;
+		}
+
+		return Evaluate( host );
+	}
+
+	template< typename T >
+	bool OpTypedIn< T >::RequiresWork() const
+	{
+		return true;
+	}
+
+	template< typename T >
+	int OpTypedIn< T >::PushResults( lua::LuaStack& luaStack )
+	{
+		UnrefChannel( luaStack );
+		return 0;
+	}
+
+	template< typename T >
+	void OpTypedIn< T >::Terminate( Host& host )
+	{
+		ThisChannel().DetachIn( Waiter() );
+		OpChannel::Terminate( host );
+	}
+
+	template< typename T >
+	Process& OpTypedIn< T >::ProcessToEvaluate()
+	{
+		return ThisProcess();
+	}
+
+	template< typename T >
+	void OpTypedIn< T >::MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments )
+	{
+		OpChannel::MoveChannelArguments( fromStack, numArguments );
+		ReadArguments();
+		channel.DetachIn( Waiter() );
+	}
+
+	template< typename T >
+	bool OpTypedIn< T >::MovePayload( Channel& channel, const void* payloadType, void* pPayload )
+	{
+		if( payloadType != TypedChannel< T >::PayloadType() )
+			return false;
+
+		m_payload = std::move( *static_cast< T* >( pPayload ) );
+		m_hasPayload = true;
+		channel.DetachIn( Waiter() );
+		return true;
+	}
+
+	template< typename T >
+	void OpTypedIn< T >::CloseChannel( Host& host, Channel& channel )
+	{
+		OpChannel::CloseChannel( host, channel );
+		channel.DetachIn( Waiter() );
+	}
+
+	template< typename T >
+	void OpTypedIn< T >::ReadArguments()
+	{
+		lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+		int numArguments = NumArguments();
+
+		m_hasPayload = ReadPayload( stack, numArguments, m_payload );
+		stack.Pop( numArguments );
+		ArgumentsMoved();
+	}
+
+	template< typename T >
+	bool OpTypedIn< T >::IsInputAttached()
+	{
+		return Waiter().IsQueued();
+	}
 }
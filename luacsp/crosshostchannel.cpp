@@ -0,0 +1,443 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "crosshostchannel.h"
+
+#include <core/thread.h>
+#include <luacpp/luastackvalue.h>
+
+#include <string.h>
+
+#include "host.h"
+
+namespace csp
+{
+	int CrossHostChannel_new( lua_State* luaState );
+	int CrossHostChannel_IN( lua_State* luaState );
+	int CrossHostChannel_OUT( lua_State* luaState );
+
+	const csp::FunctionRegistration crossHostChannelGlobals[] =
+	{
+		"new", csp::CrossHostChannel_new
+		, NULL, NULL
+	};
+
+	const csp::FunctionRegistration crossHostChannelFunctions[] =
+	{
+		"__gc", csp::GcObject_Gc
+		, "IN", csp::CrossHostChannel_IN
+		, "OUT", csp::CrossHostChannel_OUT
+		, NULL, NULL
+	};
+}
+
+csp::CrossHostValue::CrossHostValue()
+	: type( CrossHostValueType::NIL )
+	, boolean( false )
+	, number( 0 )
+	, string()
+	, length( 0 )
+{
+}
+
+
+csp::CrossHostMessage::CrossHostMessage( int numValues )
+	: m_values()
+	, m_numValues( numValues )
+{
+	if( m_numValues > 0 )
+		m_values = CORE_NEW CrossHostValue[ m_numValues ];
+}
+
+csp::CrossHostMessage::~CrossHostMessage()
+{
+	for( int i = 0; i < m_numValues; ++i )
+		ResetValue( i );
+
+	delete[] m_values;
+	m_values = NULL;
+}
+
+int csp::CrossHostMessage::NumValues() const
+{
+	return m_numValues;
+}
+
+void csp::CrossHostMessage::ResetValue( int index )
+{
+	CORE_ASSERT( index >= 0 && index < m_numValues );
+	CrossHostValue& value = m_values[ index ];
+
+	delete[] value.string;
+	value = CrossHostValue();
+}
+
+void csp::CrossHostMessage::SetNil( int index )
+{
+	ResetValue( index );
+}
+
+void csp::CrossHostMessage::SetBoolean( int index, bool value )
+{
+	ResetValue( index );
+	m_values[ index ].type = CrossHostValueType::BOOLEAN;
+	m_values[ index ].boolean = value;
+}
+
+void csp::CrossHostMessage::SetNumber( int index, lua::LuaNumber_t value )
+{
+	ResetValue( index );
+	m_values[ index ].type = CrossHostValueType::NUMBER;
+	m_values[ index ].number = value;
+}
+
+void csp::CrossHostMessage::SetString( int index, const char* str, size_t length )
+{
+	ResetValue( index );
+	CrossHostValue& value = m_values[ index ];
+
+	value.type = CrossHostValueType::STRING;
+	value.string = CORE_NEW char[ length + 1 ];
+	memcpy( value.string, str, length );
+	value.string[ length ] = 0;
+	value.length = length;
+}
+
+bool csp::CrossHostMessage::SetValue( int index, const lua::LuaStackValue& value )
+{
+	if( value.IsNil() )
+		SetNil( index );
+	else if( value.IsBoolean() )
+		SetBoolean( index, value.GetBoolean() );
+	else if( value.IsNumber() )
+		SetNumber( index, value.GetNumber() );
+	else if( value.IsString() )
+	{
+		size_t length = 0;
+		const char* str = value.GetLString( length );
+		SetString( index, str, length );
+	}
+	else
+		return false;
+
+	return true;
+}
+
+int csp::CrossHostMessage::PushValues( lua::LuaStack& luaStack ) const
+{
+	luaStack.CheckStack( m_numValues );
+	for( int i = 0; i < m_numValues; ++i )
+	{
+		const CrossHostValue& value = m_values[ i ];
+		switch( value.type )
+		{
+		case CrossHostValueType::NIL:
+			luaStack.PushNil();
+			break;
+		case CrossHostValueType::BOOLEAN:
+			luaStack.PushBoolean( value.boolean );
+			break;
+		case CrossHostValueType::NUMBER:
+			luaStack.PushNumber( value.number );
+			break;
+		case CrossHostValueType::STRING:
+			luaStack.PushLString( value.string, value.length );
+			break;
+		}
+	}
+
+	return m_numValues;
+}
+
+
+csp::CrossHostChannel* csp::CrossHostChannel::Create( int capacity )
+{
+	return CORE_NEW CrossHostChannel( capacity );
+}
+
+csp::CrossHostChannel::CrossHostChannel( int capacity )
+	: m_cells()
+	, m_mask( 0 )
+	, m_capacity( capacity )
+	, m_enqueuePos( 0 )
+	, m_dequeuePos( 0 )
+	, m_refCount( 1 )
+{
+	CORE_ASSERT( capacity > 0 );
+
+	// the ring is rounded up to a power of two, TryPush keeps the requested bound
+	long size = 2;
+	while( size < capacity )
+		size *= 2;
+
+	m_cells = CORE_NEW Cell[ size ];
+	for( long i = 0; i < size; ++i )
+	{
+		m_cells[ i ].sequence = i;
+		m_cells[ i ].pMessage = NULL;
+	}
+
+	m_mask = size - 1;
+}
+
+csp::CrossHostChannel::~CrossHostChannel()
+{
+	while( CrossHostMessage* pMessage = TryPop() )
+		delete pMessage;
+
+	delete[] m_cells;
+	m_cells = NULL;
+}
+
+void csp::CrossHostChannel::AddRef()
+{
+	core::AtomicIncrement( m_refCount );
+}
+
+void csp::CrossHostChannel::Release()
+{
+	if( core::AtomicDecrement( m_refCount ) == 0 )
+		delete this;
+}
+
+int csp::CrossHostChannel::Capacity() const
+{
+	return (int)m_capacity;
+}
+
+bool csp::CrossHostChannel::TryPush( CrossHostMessage* pMessage )
+{
+	CORE_ASSERT( pMessage );
+
+	Cell* pCell;
+	long pos = core::AtomicLoad( m_enqueuePos );
+	for(;;)
+	{
+		pCell = &m_cells[ pos & m_mask ];
+		long sequence = core::AtomicLoad( pCell->sequence );
+		long difference = (long)( (unsigned long)sequence - (unsigned long)pos );
+
+		if( difference == 0 )
+		{
+			// dequeuePos only grows: a stale value can only make the channel look fuller
+			long numQueued = (long)( (unsigned long)pos - (unsigned long)core::AtomicLoad( m_dequeuePos ) );
+			if( numQueued >= m_capacity )
+				return false; // full
+
+			if( core::AtomicCompareExchange( m_enqueuePos, (long)( (unsigned long)pos + 1 ), pos ) == pos )
+				break;
+		}
+		else if( difference < 0 )
+			return false; // full
+
+		pos = core::AtomicLoad( m_enqueuePos );
+	}
+
+	pCell->pMessage = pMessage;
+	core::AtomicStore( pCell->sequence, (long)( (unsigned long)pos + 1 ) );
+	return true;
+}
+
+csp::CrossHostMessage* csp::CrossHostChannel::TryPop()
+{
+	Cell* pCell;
+	long pos = core::AtomicLoad( m_dequeuePos );
+	for(;;)
+	{
+		pCell = &m_cells[ pos & m_mask ];
+		long sequence = core::AtomicLoad( pCell->sequence );
+		long difference = (long)( (unsigned long)sequence - ( (unsigned long)pos + 1 ) );
+
+		if( difference == 0 )
+		{
+			if( core::AtomicCompareExchange( m_dequeuePos, (long)( (unsigned long)pos + 1 ), pos ) == pos )
+				break;
+		}
+		else if( difference < 0 )
+			return NULL; // empty
+
+		pos = core::AtomicLoad( m_dequeuePos );
+	}
+
+	CrossHostMessage* pMessage = pCell->pMessage;
+	pCell->pMessage = NULL;
+	core::AtomicStore( pCell->sequence, (long)( (unsigned long)pos + (unsigned long)m_mask + 1 ) );
+	return pMessage;
+}
+
+
+csp::CrossHostChannelHandle::CrossHostChannelHandle( CrossHostChannel& channel )
+	: m_channel( channel )
+{
+	m_channel.AddRef();
+}
+
+csp::CrossHostChannelHandle::~CrossHostChannelHandle()
+{
+	m_channel.Release();
+}
+
+csp::CrossHostChannel& csp::CrossHostChannelHandle::SharedChannel() const
+{
+	return m_channel;
+}
+
+
+csp::OpCrossHostChannel::OpCrossHostChannel()
+	: m_pMessage()
+	, m_pChannel()
+{
+}
+
+csp::OpCrossHostChannel::~OpCrossHostChannel()
+{
+	delete m_pMessage;
+	m_pMessage = NULL;
+
+	if( m_pChannel )
+		m_pChannel->Release();
+	m_pChannel = NULL;
+}
+
+bool csp::OpCrossHostChannel::InitChannel( lua::LuaStack& args, InitError& initError )
+{
+	lua::LuaStackValue channelArg = args[1];
+	if( !IsCrossHostChannelArg( channelArg ) )
+		return initError.ArgError( 1, "cross host channel expected" );
+
+	m_pChannel = GetCrossHostChannelArg( channelArg );
+	if( m_pChannel == NULL )
+		return initError.ArgError( 1, "cross host channel pointer expected" );
+
+	m_pChannel->AddRef();
+	return true;
+}
+
+csp::CrossHostChannel& csp::OpCrossHostChannel::ThisChannel() const
+{
+	CORE_ASSERT( m_pChannel );
+	return *m_pChannel;
+}
+
+bool csp::OpCrossHostChannel::RequiresWork() const
+{
+	// the other side lives in another host: poll the ring each tick
+	return true;
+}
+
+
+bool csp::OpCrossHostOut::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !InitChannel( args, initError ) )
+		return false;
+
+	m_pMessage = CORE_NEW CrossHostMessage( args.NumArgs() - 1 );
+	for( int i = 2; i <= args.NumArgs(); ++i )
+	{
+		if( !m_pMessage->SetValue( i-2, args[ i ] ) )
+			return initError.ArgError( i, "nil, boolean, number or string expected" );
+	}
+
+	if( ThisChannel().TryPush( m_pMessage ) )
+	{
+		m_pMessage = NULL;
+		SetFinished( true );
+	}
+
+	return true;
+}
+
+csp::WorkResult::Enum csp::OpCrossHostOut::Work( Host&, CspTime_t )
+{
+	if( m_pMessage && ThisChannel().TryPush( m_pMessage ) )
+		m_pMessage = NULL;
+
+	return m_pMessage ? WorkResult::YIELD : WorkResult::FINISH;
+}
+
+
+bool csp::OpCrossHostIn::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !InitChannel( args, initError ) )
+		return false;
+
+	m_pMessage = ThisChannel().TryPop();
+	if( m_pMessage )
+		SetFinished( true );
+
+	return true;
+}
+
+csp::WorkResult::Enum csp::OpCrossHostIn::Work( Host&, CspTime_t )
+{
+	if( m_pMessage == NULL )
+		m_pMessage = ThisChannel().TryPop();
+
+	return m_pMessage ? WorkResult::FINISH : WorkResult::YIELD;
+}
+
+int csp::OpCrossHostIn::PushResults( lua::LuaStack& luaStack )
+{
+	CORE_ASSERT( m_pMessage );
+	return m_pMessage->PushValues( luaStack );
+}
+
+
+int csp::CrossHostChannel_new( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	int capacity = args[2].OptInteger( 1 );
+	if( capacity < 1 )
+		return args[2].ArgError( "positive capacity expected" );
+
+	CrossHostChannel* pChannel = CrossHostChannel::Create( capacity );
+	PushCrossHostChannel( luaState, *pChannel );
+	pChannel->Release();
+	return 1;
+}
+
+int csp::CrossHostChannel_IN( lua_State* luaState )
+{
+	OpCrossHostIn* pIn = new( Host::GetHost( luaState ) ) OpCrossHostIn();
+	return pIn->DoInit( luaState );
+}
+
+int csp::CrossHostChannel_OUT( lua_State* luaState )
+{
+	OpCrossHostOut* pOut = new( Host::GetHost( luaState ) ) OpCrossHostOut();
+	return pOut->DoInit( luaState );
+}
+
+void csp::PushCrossHostChannel( lua_State* luaState, CrossHostChannel& channel )
+{
+	new( PushGcObjectMemory( luaState, sizeof( CrossHostChannelHandle ), crossHostChannelFunctions ) ) CrossHostChannelHandle( channel );
+}
+
+bool csp::IsCrossHostChannelArg( lua::LuaStackValue const& value )
+{
+	return IsGcObject( value, crossHostChannelFunctions );
+}
+
+csp::CrossHostChannel* csp::GetCrossHostChannelArg( lua::LuaStackValue const& value )
+{
+	CrossHostChannelHandle* pHandle = static_cast< CrossHostChannelHandle* >( GetGcObject( value, crossHostChannelFunctions ) );
+	if( pHandle == NULL )
+		return NULL;
+
+	return &pHandle->SharedChannel();
+}
+
+
+void csp::InitializeCrossHostChannels( lua::LuaState& state )
+{
+	InitializeCspObject( state, "CrossHostChannel", crossHostChannelGlobals, crossHostChannelFunctions );
+}
+
+void csp::ShutdownCrossHostChannels( lua::LuaState& state )
+{
+	ShutdownCspObject( state, "CrossHostChannel", crossHostChannelGlobals, crossHostChannelFunctions );
+}
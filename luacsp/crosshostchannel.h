@@ -0,0 +1,157 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <luacpp/luacpp.h>
+
+#include "csp.h"
+#include "operation.h"
+
+namespace csp
+{
+	namespace CrossHostValueType
+	{
+		enum Enum
+		{
+			  NIL = 0
+			, BOOLEAN
+			, NUMBER
+			, STRING
+		};
+	}
+
+	struct CrossHostValue
+	{
+		CrossHostValue();
+
+		CrossHostValueType::Enum type;
+		bool boolean;
+		lua::LuaNumber_t number;
+		char* string;
+		size_t length;
+	};
+
+	// Serialized copy of OUT arguments: only values which don't belong to a particular lua_State can cross hosts.
+	class CrossHostMessage
+	{
+	public:
+		explicit CrossHostMessage( int numValues );
+		~CrossHostMessage();
+
+		int NumValues() const;
+
+		void SetNil( int index );
+		void SetBoolean( int index, bool value );
+		void SetNumber( int index, lua::LuaNumber_t value );
+		void SetString( int index, const char* str, size_t length );
+
+		bool SetValue( int index, const lua::LuaStackValue& value );
+		int PushValues( lua::LuaStack& luaStack ) const;
+
+	private:
+		CrossHostMessage( const CrossHostMessage& );
+		CrossHostMessage& operator=( const CrossHostMessage& );
+
+		void ResetValue( int index );
+
+		CrossHostValue* m_values;
+		int m_numValues;
+	};
+
+	// Bounded lock-free MPMC ring of messages (D. Vyukov's algorithm), shared by reference between hosts.
+	// Buffered semantics: OUT completes as soon as the message is queued, a full channel blocks OUT
+	// and an empty one blocks IN. Blocked operations poll the ring on each Host::Work.
+	// The channel holds at most the requested capacity, although the ring is rounded up to a power of two.
+	class CrossHostChannel
+	{
+	public:
+		static CrossHostChannel* Create( int capacity );
+
+		void AddRef();
+		void Release();
+
+		int Capacity() const;
+
+		bool TryPush( CrossHostMessage* pMessage );
+		CrossHostMessage* TryPop();
+
+	private:
+		explicit CrossHostChannel( int capacity );
+		~CrossHostChannel();
+
+		CrossHostChannel( const CrossHostChannel& );
+		CrossHostChannel& operator=( const CrossHostChannel& );
+
+		struct Cell
+		{
+			volatile long sequence;
+			CrossHostMessage* pMessage;
+		};
+
+		Cell* m_cells;
+		long m_mask;
+		long m_capacity;
+
+		volatile long m_enqueuePos;
+		volatile long m_dequeuePos;
+		volatile long m_refCount;
+	};
+
+	// Lua-side handle: keeps the shared channel alive while the userdata is alive.
+	class CrossHostChannelHandle : public GcObject
+	{
+	public:
+		explicit CrossHostChannelHandle( CrossHostChannel& channel );
+		virtual ~CrossHostChannelHandle();
+
+		CrossHostChannel& SharedChannel() const;
+
+	private:
+		CrossHostChannel& m_channel;
+	};
+
+	class OpCrossHostChannel : public Operation
+	{
+	public:
+		OpCrossHostChannel();
+		virtual ~OpCrossHostChannel();
+
+	protected:
+		bool InitChannel( lua::LuaStack& args, InitError& initError );
+		CrossHostChannel& ThisChannel() const;
+
+		virtual bool RequiresWork() const;
+
+		CrossHostMessage* m_pMessage;
+
+	private:
+		CrossHostChannel* m_pChannel;
+	};
+
+	class OpCrossHostOut : public OpCrossHostChannel
+	{
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+	};
+
+	class OpCrossHostIn : public OpCrossHostChannel
+	{
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual int PushResults( lua::LuaStack& luaStack );
+	};
+
+	void PushCrossHostChannel( lua_State* luaState, CrossHostChannel& channel );
+	bool IsCrossHostChannelArg( lua::LuaStackValue const& value );
+	CrossHostChannel* GetCrossHostChannelArg( lua::LuaStackValue const& value );
+
+	void InitializeCrossHostChannels( lua::LuaState& state );
+	void ShutdownCrossHostChannels( lua::LuaState& state );
+}
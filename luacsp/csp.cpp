@@ -12,9 +12,50 @@
 
 #include "host.h"
 
+#include <new>
+
 namespace csp
 {
-	void PushGcObject( lua_State* luaState, GcObject& gcObject, void* metatableRegistryKey );
+	// Leads every GcObject userdata block, the object itself is constructed right after it.
+	struct GcObjectHeader
+	{
+		const FunctionRegistration* typeTag;
+		bool alive;
+	};
+
+	// keeps the object aligned as operator new does
+	static const size_t GC_OBJECT_HEADER_SIZE = 16;
+
+	// Only csp metatables are ever set on csp userdata, so the header of any other userdata is never read.
+	static GcObjectHeader* GetGcObjectHeader( lua::LuaStackValue const& value, const FunctionRegistration memberFunctions[] )
+	{
+		if( !value.IsUserData() || !CspHasMetatable( value.InternalState(), value, memberFunctions ) )
+			return NULL;
+
+		CORE_ASSERT( value.RawLength() >= GC_OBJECT_HEADER_SIZE );
+		GcObjectHeader* pHeader = static_cast< GcObjectHeader* >( value.GetUserData() );
+		CORE_ASSERT( pHeader->typeTag == memberFunctions );
+		return pHeader;
+	}
+
+	// __gc can be taken from a metatable and called with any userdata: it must carry a metatable
+	// whose __gc is ours.
+	static bool HasGcObjectMetatable( lua::LuaStackValue const& value )
+	{
+		lua::LuaStack stack( value.InternalState() );
+
+		if( !value.IsUserData() || !stack.GetMetaTable( value ) )
+			return false;
+
+		lua::LuaStackValue metatable = stack.GetTopValue();
+		stack.PushString( "__gc" );
+		lua::LuaStackValue gc = stack.RawGet( metatable );
+
+		bool result = gc.IsCFunction() && gc.GetCFunction() == GcObject_Gc;
+
+		stack.Pop( 2 );
+		return result;
+	}
 }
 
 csp::Host& csp::Initialize()
@@ -95,15 +136,35 @@ bool csp::CspHasMetatable( lua_State* luaState, const lua::LuaStackValue& value,
 	return result;
 }
 
-void csp::PushGcObject( lua_State* luaState, GcObject& gcObject, const FunctionRegistration memberFunctions[] )
+void* csp::PushGcObjectMemory( lua_State* luaState, size_t size, const FunctionRegistration memberFunctions[] )
 {
+	static_assert( sizeof( GcObjectHeader ) <= GC_OBJECT_HEADER_SIZE, "gc object header doesn't fit" );
+
 	lua::LuaStack args( luaState );
 
-	GcObject** ppGcObject = (GcObject**)args.PushUserData( sizeof(GcObject*) );
-	*ppGcObject = &gcObject;
+	char* pMemory = static_cast< char* >( args.PushUserData( GC_OBJECT_HEADER_SIZE + size ) );
 	lua::LuaStackValue userData = args.GetTopValue();
+	CspSetMetatable( luaState, userData, memberFunctions );
 
-	return CspSetMetatable( luaState, userData, memberFunctions );
+	GcObjectHeader* pHeader = new( pMemory ) GcObjectHeader();
+	pHeader->typeTag = memberFunctions;
+	pHeader->alive = true;
+
+	return pMemory + GC_OBJECT_HEADER_SIZE;
+}
+
+bool csp::IsGcObject( lua::LuaStackValue const& value, const FunctionRegistration memberFunctions[] )
+{
+	return GetGcObjectHeader( value, memberFunctions ) != NULL;
+}
+
+csp::GcObject* csp::GetGcObject( lua::LuaStackValue const& value, const FunctionRegistration memberFunctions[] )
+{
+	GcObjectHeader* pHeader = GetGcObjectHeader( value, memberFunctions );
+	if( pHeader == NULL || !pHeader->alive )
+		return NULL;
+
+	return reinterpret_cast< GcObject* >( reinterpret_cast< char* >( pHeader ) + GC_OBJECT_HEADER_SIZE );
 }
 
 int csp::GcObject_Gc( lua_State* luaState )
@@ -113,11 +174,17 @@ int csp::GcObject_Gc( lua_State* luaState )
 	CORE_ASSERT( args.NumArgs() == 1 );
 	lua::LuaStackValue userData = args[1];
 
-	CORE_ASSERT( userData.IsUserData() );
-	GcObject** pGcObject = (GcObject**)userData.GetUserData();
+	if( !HasGcObjectMetatable( userData ) )
+		return 0;
 
-	delete *pGcObject;
-	*pGcObject = NULL;
+	GcObjectHeader* pHeader = static_cast< GcObjectHeader* >( userData.GetUserData() );
+
+	if( pHeader->alive )
+	{
+		pHeader->alive = false;
+		GcObject* pGcObject = reinterpret_cast< GcObject* >( reinterpret_cast< char* >( pHeader ) + GC_OBJECT_HEADER_SIZE );
+		pGcObject->~GcObject();
+	}
 	return 0;
 }
 
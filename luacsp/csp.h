@@ -12,6 +12,7 @@ struct lua_State;
 namespace lua
 {
 	class LuaState;
+	class LuaStack;
 	class LuaStackValue;
 }
 
@@ -20,8 +21,6 @@ namespace csp
 	class Host;
 	class Process;
 	class Channel;
-
-	struct ChannelArgument;
 }
 
 namespace csp
@@ -52,12 +51,31 @@ namespace csp
 
 	struct ChannelAttachmentIn_i : ChannelAttachment_i
 	{
-		virtual void MoveChannelArguments( Channel& channel, ChannelArgument* arguments, int numArguments ) = 0;
+		// The arguments are the top numArguments values of fromStack: move them with lua_xmove.
+		virtual void MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments ) = 0;
+		// A C++ writer offers its payload in place. Readers which take Lua values refuse it.
+		virtual bool MovePayload( Channel&, const void* /*payloadType*/, void* /*pPayload*/ ) { return false; }
 	};
 
 	struct ChannelAttachmentOut_i : ChannelAttachment_i
 	{
-		virtual void Communicate( Host& host, Process& inputProcess ) = 0;
+		// Moves the values to the given reader, not necessarily the first one in the channel queue.
+		// The reader pulls them while it's evaluated, so the writer only wakes up itself.
+		virtual void Communicate( Host& host, ChannelAttachmentIn_i& in ) = 0;
+		// A reader freed a place in the channel buffer: the values go there instead.
+		virtual void MoveToBuffer( Host& host ) = 0;
+	};
+
+	struct TimerAttachment_i
+	{
+		virtual void ExpireTimer( Host& host ) = 0;
+	};
+
+	struct ParentAttachment_i
+	{
+		// Called instead of waking the parent up. The finished process isn't touched after the call,
+		// so the attachment may delete it right away.
+		virtual void ChildFinished( Host& host, Process& process ) = 0;
 	};
 
 	struct FunctionRegistration
@@ -83,7 +101,13 @@ namespace csp
 		, const FunctionRegistration memberFunctions[] );
 
 
-	void PushGcObject( lua_State* luaState, GcObject& gcObject, const FunctionRegistration memberFunctions[] );
+	// GcObjects are constructed in place inside their userdata, GcObject must be their first base class:
+	// new( PushGcObjectMemory( luaState, sizeof( T ), memberFunctions ) ) T( ... ) leaves the userdata on the stack.
+	void* PushGcObjectMemory( lua_State* luaState, size_t size, const FunctionRegistration memberFunctions[] );
+	// The member functions tag the userdata, so its type is checked without a metatable lookup.
+	bool IsGcObject( lua::LuaStackValue const& value, const FunctionRegistration memberFunctions[] );
+	// NULL if the value isn't an object of that type or the object is already collected.
+	GcObject* GetGcObject( lua::LuaStackValue const& value, const FunctionRegistration memberFunctions[] );
 	int GcObject_Gc( lua_State* luaState );
 
 	lua::LuaStackValue PushCspMetatable( lua_State* luaState, const FunctionRegistration memberFunctions[] );
@@ -18,6 +18,7 @@ namespace helpers
 	int log( lua_State* luaState );
 	int time( lua_State* luaState );
 	int tick( lua_State* luaState );
+	int stats( lua_State* luaState );
 }
 
 int helpers::log( lua_State* luaState )
@@ -53,11 +54,39 @@ int helpers::tick( lua_State* luaState )
 	return 1;
 }
 
+int helpers::stats( lua_State* luaState )
+{
+	lua::LuaStack stack( luaState );
+
+	const csp::HostStats& stats = csp::Host::GetHost( luaState ).Stats();
+
+	const struct { const char* name; unsigned int value; } fields[] =
+	{
+		  { "numPreemptions", stats.numPreemptions }
+		, { "numThreadPoolHits", stats.numThreadPoolHits }
+		, { "numThreadPoolMisses", stats.numThreadPoolMisses }
+		, { "numThreadPoolDiscards", stats.numThreadPoolDiscards }
+		, { "numPooledAllocations", stats.numPooledAllocations }
+		, { "numHeapAllocations", stats.numHeapAllocations }
+		, { "numEvalSteps", stats.numEvalSteps }
+	};
+	const int numFields = sizeof( fields ) / sizeof( fields[0] );
+
+	lua::LuaStackValue table = stack.PushTable( 0, numFields );
+	for( int i = 0; i < numFields; ++i )
+	{
+		stack.PushNumber( fields[i].value );
+		stack.SetField( table, fields[i].name );
+	}
+	return 1;
+}
+
 const csp::FunctionRegistration helpersDescriptions[] =
 {
   	  "log", helpers::log
 	, "time", helpers::time
 	, "tick", helpers::tick
+	, "stats", helpers::stats
 	, NULL, NULL
 };
 
@@ -9,38 +9,59 @@
 
 #include <luacpp/luastackvalue.h>
 
+#include <math.h>
+
 #include "operation.h"
 #include "helpers.h"
 #include "channel.h"
 #include "cppchannel.h"
 #include "swarm.h"
+#include "selector.h"
 #include "contract.h"
 #include "op_lua.h"
+#include "crosshostchannel.h"
 
 namespace csp
 {
-	static const int CHANNEL_STACK_SIZE = 256;
 	static const char HOST_IDENTITY_KEY = 0;
+	static const int PREEMPTION_HOOK_INTERVAL = 1000;
+	// AdvanceToNextEvent skips at most this many ticks at once: a distant or infinite deadline fits in the tick counter.
+	static const unsigned int MAX_TICKS_TO_SKIP = 1u << 30;
+}
+
+csp::HostStats::HostStats()
+	: numPreemptions( 0 )
+	, numThreadPoolHits( 0 )
+	, numThreadPoolMisses( 0 )
+	, numThreadPoolDiscards( 0 )
+	, numPooledAllocations( 0 )
+	, numHeapAllocations( 0 )
+	, numEvalSteps( 0 )
+{
 }
 
+
 csp::Host::Host(const lua::LuaState& luaState)
     : m_luaState(luaState)
 	, m_mainProcess()
-	, m_evalStepsStack()
-	, m_evalStepsStackTop( 0 )
+	, m_evalSteps( ProcessLists::EVAL )
+	, m_evalOrder( EvalOrder::LIFO )
+	, m_timers()
+	, m_workSet( ProcessLists::WORK )
+	, m_preempted( ProcessLists::PREEMPTED )
+	, m_pRunningProcess()
+	, m_instructionBudget( 0 )
+	, m_instructionsLeft( 0 )
+	, m_stats()
+	, m_coroutines( m_luaState, m_stats )
+	, m_allocator( m_stats )
 	, m_time( 0 )
 	, m_tick( 0 )
 {
-	m_evalStepsStack = CORE_NEW Process*[ CHANNEL_STACK_SIZE ];
-	
-	for( int i = 0; i < CHANNEL_STACK_SIZE; ++i )
-		m_evalStepsStack[i] = NULL;
 }
 
 csp::Host::~Host()
 {
-	delete[] m_evalStepsStack;
-	m_evalStepsStack = NULL;
 }
 
 lua::LuaState& csp::Host::LuaState()
@@ -72,8 +93,10 @@ void csp::Host::Initialize()
 	InitializeChannels( m_luaState );
 	InitializeCppChannels( m_luaState );
 	InitializeSwarms( m_luaState );
+	InitializeSelectors( m_luaState );
 	InitializeContracts( m_luaState );
 	InitializeOpLua( m_luaState );
+	InitializeCrossHostChannels( m_luaState );
 	
 	m_luaState.GetStack().Pop(1);
 
@@ -83,6 +106,7 @@ void csp::Host::Initialize()
 
 void csp::Host::Shutdown()
 {
+	m_coroutines.Clear();
 	m_luaState.ReportRefLeaks();
 
 	m_luaState.GetStack().PushNil();
@@ -90,7 +114,9 @@ void csp::Host::Shutdown()
 
 	lua::LuaStackValue globals = m_luaState.GetStack().PushGlobalTable();
 
+	ShutdownCrossHostChannels( m_luaState );
 	ShutdownContracts( m_luaState );
+	ShutdownSelectors( m_luaState );
 	ShutdownSwarms( m_luaState );
 	ShutdownCppChannels( m_luaState );
 	ShutdownChannels( m_luaState );
@@ -125,86 +151,224 @@ void csp::Host::Evaluate()
 }
 
 csp::WorkResult::Enum csp::Host::Work( CspTime_t dt )
+{
+	return Work( dt, 0 );
+}
+
+csp::WorkResult::Enum csp::Host::Work( CspTime_t dt, int instructionBudget )
 {
 	if( !m_mainProcess.IsRunning() )
 		return WorkResult::FINISH;
 
+	m_instructionBudget = instructionBudget;
+	m_instructionsLeft = instructionBudget;
+
 	m_time += dt;
 	m_tick++;
 
-	m_mainProcess.Work( *this, dt );
+	m_timers.Expire( *this, m_time );
+
+	// The oldest operation gets evaluated first in both orders: newest first for LIFO, oldest first for FIFO.
+	bool lifo = m_evalOrder == EvalOrder::LIFO;
+	for( Process* pProcess = lifo ? m_workSet.Tail() : m_workSet.Head(); pProcess; )
+	{
+		Process& process = *pProcess;
+		pProcess = lifo ? m_workSet.Prev( process ) : m_workSet.Next( process );
+		process.Work( *this, dt );
+	}
+
+	ResumePreempted();
 	Evaluate();
 
+	m_instructionBudget = 0;
 	return m_mainProcess.IsRunning() ? WorkResult::YIELD : WorkResult::FINISH;
 }
 
+csp::WorkResult::Enum csp::Host::AdvanceToNextEvent( CspTime_t dt, int instructionBudget )
+{
+	CspTime_t deadline;
+	if( dt > 0 && IsIdle() && NextDeadline( deadline ) )
+	{
+		// nothing can change state before the deadline: skip the ticks which end before it.
+		CspTime_t ticksToDeadline = ceil( ( deadline - m_time ) / dt );
+		if( ticksToDeadline > MAX_TICKS_TO_SKIP + 1 )
+			ticksToDeadline = MAX_TICKS_TO_SKIP + 1;
+
+		if( ticksToDeadline > 1 )
+		{
+			unsigned int ticksToSkip = (unsigned int)ticksToDeadline - 1;
+			m_time += ticksToSkip * dt;
+			m_tick += ticksToSkip;
+		}
+	}
+
+	return Work( dt, instructionBudget );
+}
+
+bool csp::Host::IsIdle() const
+{
+	return m_workSet.IsEmpty() && m_preempted.IsEmpty() && m_evalSteps.IsEmpty();
+}
+
+bool csp::Host::NextDeadline( CspTime_t& deadline ) const
+{
+	if( m_timers.IsEmpty() )
+		return false;
+
+	deadline = m_timers.NextDeadline();
+	return true;
+}
+
+void csp::Host::ResumePreempted()
+{
+	// In LIFO order push the latest preempted first, so the earliest one resumes first.
+	while( !m_preempted.IsEmpty() )
+	{
+		Process& process = m_evalOrder == EvalOrder::LIFO ? *m_preempted.Tail() : *m_preempted.Head();
+		RemovePreempted( process );
+		PushEvalStep( process );
+	}
+}
+
+void csp::Host::SetEvalOrder( EvalOrder::Enum evalOrder )
+{
+	CORE_ASSERT( IsEvalsStackEmpty() );
+	m_evalOrder = evalOrder;
+}
+
+csp::EvalOrder::Enum csp::Host::GetEvalOrder() const
+{
+	return m_evalOrder;
+}
+
 void csp::Host::PushEvalStep( Process& process )
 {
-	CORE_ASSERT( m_evalStepsStackTop >= 0 && m_evalStepsStackTop < CHANNEL_STACK_SIZE );
+	// In FIFO order a process can be woken up again while it waits for its turn: keep its place in the queue.
+	// In LIFO order it's moved to the top.
+	if( process.IsOnStack() )
+	{
+		if( m_evalOrder == EvalOrder::FIFO )
+			return;
+		m_evalSteps.Remove( process );
+	}
 
-	CORE_ASSERT( !process.IsOnStack() );
 	process.SetIsOnStack( true );
 
-	m_evalStepsStack[ m_evalStepsStackTop ] = &process;
-	++m_evalStepsStackTop;
+	if( m_evalOrder == EvalOrder::FIFO )
+		m_evalSteps.PushBack( process );
+	else
+		m_evalSteps.PushFront( process );
 }
 
-csp::Process& csp::Host::PopEvalStep()
+void csp::Host::PushEvalStepFirst( Process& process )
 {
-	CORE_ASSERT( m_evalStepsStackTop > 0 && m_evalStepsStackTop <= CHANNEL_STACK_SIZE );
-	--m_evalStepsStackTop;
+	// Used to notify parents: in FIFO order finished children are handled before other wake-ups.
+	// LIFO order keeps a process already on the stack in place.
+	if( process.IsOnStack() )
+	{
+		if( m_evalOrder == EvalOrder::LIFO )
+			return;
+		m_evalSteps.Remove( process );
+	}
 
-	Process* pProcess = m_evalStepsStack[ m_evalStepsStackTop ];
-	CORE_ASSERT( pProcess );
-	m_evalStepsStack[ m_evalStepsStackTop ] = NULL;
+	process.SetIsOnStack( true );
+	m_evalSteps.PushFront( process );
+}
 
-	pProcess->SetIsOnStack( false );
+csp::Process& csp::Host::PopEvalStep()
+{
+	Process& process = m_evalSteps.PopFront();
+	process.SetIsOnStack( false );
 
-	return *pProcess;
+	++m_stats.numEvalSteps;
+	return process;
 }
 
-void csp::Host::RemoveProcessFromStack( const Process& process )
+void csp::Host::EvaluateNext( Process& process )
 {
-	int writePos = 0;
-	for( int i = 0; i < m_evalStepsStackTop; ++i )
-	{		
-		Process* pProcess = m_evalStepsStack[ i ];
-		if( writePos < i )
-		{
-			m_evalStepsStack[ writePos ] = pProcess;
-			m_evalStepsStack[ i ] = NULL;
-		}
-
-		if( pProcess != &process )
-			++writePos;
+	// FIFO order queues the process ahead of the other wake-ups: like a direct evaluation,
+	// it runs (and notifies its parent) before the process which handed the values over resumes.
+	if( m_evalOrder == EvalOrder::FIFO )
+	{
+		PushEvalStepFirst( process );
+		return;
 	}
 
-	m_evalStepsStack[ writePos ] = NULL;
-	m_evalStepsStackTop = writePos;
+	if( process.IsOnStack() )
+		RemoveProcessFromStack( process );
+
+	process.Evaluate( *this, 0 );
+}
+
+void csp::Host::RemoveProcessFromStack( Process& process )
+{
+	m_evalSteps.Remove( process );
+	process.SetIsOnStack( false );
 }
 
 bool csp::Host::IsEvalsStackEmpty() const
 {
-	return m_evalStepsStackTop <= 0;
+	return m_evalSteps.IsEmpty();
 }
 
-csp::Process* csp::Host::GetTopProcess() const
+bool csp::Host::DebugIsProcessOnStack( const Process& process ) const
 {
-	CORE_ASSERT( m_evalStepsStackTop >= 0 && m_evalStepsStackTop < CHANNEL_STACK_SIZE );
+	return m_evalSteps.Contains( process );
+}
 
-	return m_evalStepsStackTop > 0 ? m_evalStepsStack[ m_evalStepsStackTop-1 ] : NULL;
+void csp::Host::AddToWorkSet( Process& process )
+{
+	m_workSet.PushBack( process );
 }
 
+void csp::Host::RemoveFromWorkSet( Process& process )
+{
+	m_workSet.Remove( process );
+}
 
-bool csp::Host::DebugIsProcessOnStack( const Process& process ) const
+csp::Process* csp::Host::RunningProcess() const
 {
-	for( int i = 0; i < m_evalStepsStackTop; ++i )
-	{
-		if( &process == m_evalStepsStack[i] )
-			return true;
-	}
+	return m_pRunningProcess;
+}
 
-	return false;
+void csp::Host::SetRunningProcess( Process* pProcess )
+{
+	m_pRunningProcess = pProcess;
+}
+
+int csp::Host::PreemptionHookInterval() const
+{
+	if( m_instructionBudget <= 0 )
+		return 0;
+
+	return m_instructionBudget < PREEMPTION_HOOK_INTERVAL ? m_instructionBudget : PREEMPTION_HOOK_INTERVAL;
+}
+
+bool csp::Host::ConsumeInstructionBudget()
+{
+	if( m_instructionBudget <= 0 )
+		return false;
+
+	m_instructionsLeft -= PreemptionHookInterval();
+	return m_instructionsLeft <= 0;
+}
+
+void csp::Host::PushPreempted( Process& process )
+{
+	CORE_ASSERT( process.IsPreempted() );
+	m_preempted.PushBack( process );
+	++m_stats.numPreemptions;
+}
+
+void csp::Host::RemovePreempted( Process& process )
+{
+	m_preempted.Remove( process );
+	process.SetPreempted( false );
+}
+
+const csp::HostStats& csp::Host::Stats() const
+{
+	return m_stats;
 }
 
 csp::CspTime_t csp::Host::Time() const
@@ -217,6 +381,21 @@ unsigned int csp::Host::Tick() const
 	return m_tick;
 }
 
+csp::TimerQueue& csp::Host::Timers()
+{
+	return m_timers;
+}
+
+csp::CoroutinePool& csp::Host::Coroutines()
+{
+	return m_coroutines;
+}
+
+csp::BlockAllocator& csp::Host::Allocator()
+{
+	return m_allocator;
+}
+
 void csp::Host::TerminateMain()
 {
 	if( m_mainProcess.IsRunning() )
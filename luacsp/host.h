@@ -11,9 +11,36 @@
 
 #include "csp.h"
 #include "process.h"
+#include "timer.h"
+#include "coroutinepool.h"
+#include "allocator.h"
 
 namespace csp
 {
+	// Order of the processes woken up within a tick. LIFO (the default) resumes the latest wake-up first,
+	// FIFO serves wake-ups in arrival order. Finished children notify their parents first in both orders.
+	namespace EvalOrder
+	{
+		enum Enum
+		{
+			  LIFO = 0
+			, FIFO
+		};
+	}
+
+	struct HostStats
+	{
+		HostStats();
+
+		unsigned int numPreemptions;
+		unsigned int numThreadPoolHits;
+		unsigned int numThreadPoolMisses;
+		unsigned int numThreadPoolDiscards;
+		unsigned int numPooledAllocations;
+		unsigned int numHeapAllocations;
+		unsigned int numEvalSteps;
+	};
+
     class Host
     {
     public:
@@ -30,29 +57,76 @@ namespace csp
         WorkResult::Enum Main();
 		void TerminateMain();
 		WorkResult::Enum Work( CspTime_t dt );
+		// instructionBudget caps the number of Lua VM instructions executed in the tick (0 - unlimited).
+		// Processes running over the budget are preempted and resumed next tick.
+		WorkResult::Enum Work( CspTime_t dt, int instructionBudget );
+
+		// Fast-forward for headless runs: if no operation needs per-tick updates, skips the ticks
+		// before the earliest timer deadline and works the tick it expires in. Otherwise works a single tick.
+		WorkResult::Enum AdvanceToNextEvent( CspTime_t dt, int instructionBudget = 0 );
+
+		bool IsIdle() const;
+		bool NextDeadline( CspTime_t& deadline ) const;
 
         lua::LuaState& LuaState();
 		
 		CspTime_t Time() const;
 		unsigned int Tick() const;
 
+		TimerQueue& Timers();
+		CoroutinePool& Coroutines();
+		BlockAllocator& Allocator();
+
+		void SetEvalOrder( EvalOrder::Enum evalOrder );
+		EvalOrder::Enum GetEvalOrder() const;
+
 		void PushEvalStep( Process& process );
+		void PushEvalStepFirst( Process& process );
 		Process& PopEvalStep();
+		// Evaluates the process at once if it would be popped next anyway, saving a trip through the eval stack.
+		// Only for an operation evaluated from the eval stack which yields right after.
+		void EvaluateNext( Process& process );
 		
 		bool IsEvalsStackEmpty() const;
-		void RemoveProcessFromStack( const Process& process );
+		void RemoveProcessFromStack( Process& process );
 
 		bool DebugIsProcessOnStack( const Process& process ) const;
 
+		void AddToWorkSet( Process& process );
+		void RemoveFromWorkSet( Process& process );
+
+		Process* RunningProcess() const;
+		void SetRunningProcess( Process* pProcess );
+
+		int PreemptionHookInterval() const;
+		bool ConsumeInstructionBudget();
+
+		void PushPreempted( Process& process );
+		void RemovePreempted( Process& process );
+
+		const HostStats& Stats() const;
+
     private:
-		Process* GetTopProcess() const;
 		void Evaluate();
+		void ResumePreempted();
 
         lua::LuaState m_luaState;
 		Process m_mainProcess;
 
-		Process** m_evalStepsStack;
-		int m_evalStepsStackTop;
+		ProcessList m_evalSteps;
+		EvalOrder::Enum m_evalOrder;
+
+		TimerQueue m_timers;
+		ProcessList m_workSet;
+		ProcessList m_preempted;
+
+		Process* m_pRunningProcess;
+		int m_instructionBudget;
+		int m_instructionsLeft;
+
+		HostStats m_stats;
+		CoroutinePool m_coroutines;
+		BlockAllocator m_allocator;
 
 		unsigned int m_tick;
 		CspTime_t m_time;
@@ -0,0 +1,326 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "hostpool.h"
+
+#include "host.h"
+
+namespace csp
+{
+	static const int HOST_POOL_INITIAL_CAPACITY = 16;
+}
+
+csp::HostDeque::HostDeque()
+	: m_mutex()
+	, m_hosts()
+	, m_capacity( 0 )
+	, m_head( 0 )
+	, m_tail( 0 )
+{
+}
+
+csp::HostDeque::~HostDeque()
+{
+	delete[] m_hosts;
+	m_hosts = NULL;
+}
+
+void csp::HostDeque::Reserve( int capacity )
+{
+	core::MutexLock lock( m_mutex );
+	CORE_ASSERT( m_head == m_tail );
+
+	if( capacity <= m_capacity )
+		return;
+
+	delete[] m_hosts;
+	m_hosts = CORE_NEW int[ capacity ];
+	m_capacity = capacity;
+	m_head = m_tail = 0;
+}
+
+void csp::HostDeque::PushBack( int hostIndex )
+{
+	core::MutexLock lock( m_mutex );
+	CORE_ASSERT( m_tail < m_capacity );
+
+	m_hosts[ m_tail++ ] = hostIndex;
+}
+
+bool csp::HostDeque::PopBack( int& hostIndex )
+{
+	core::MutexLock lock( m_mutex );
+	if( m_head == m_tail )
+		return false;
+
+	hostIndex = m_hosts[ --m_tail ];
+	if( m_head == m_tail )
+		m_head = m_tail = 0;
+	return true;
+}
+
+bool csp::HostDeque::StealFront( int& hostIndex )
+{
+	core::MutexLock lock( m_mutex );
+	if( m_head == m_tail )
+		return false;
+
+	hostIndex = m_hosts[ m_head++ ];
+	if( m_head == m_tail )
+		m_head = m_tail = 0;
+	return true;
+}
+
+
+csp::HostWorker::HostWorker()
+	: pPool()
+	, index( 0 )
+	, thread()
+	, deque()
+{
+}
+
+
+csp::HostSlot::HostSlot()
+	: pHost()
+	, running( false )
+	, worker( 0 )
+	, workTime( 0 )
+	, numSteals( 0 )
+{
+}
+
+
+csp::HostPool::HostPool()
+	: m_workers()
+	, m_numWorkers( 0 )
+	, m_slots()
+	, m_numHosts( 0 )
+	, m_capacity( 0 )
+	, m_tickStart( 0 )
+	, m_tickDone( 0 )
+	, m_numPending( 0 )
+	, m_quit( 0 )
+	, m_isMain( false )
+	, m_dt( 0 )
+{
+}
+
+csp::HostPool::~HostPool()
+{
+	CORE_ASSERT( m_workers == NULL );
+	CORE_ASSERT( m_slots == NULL );
+}
+
+void csp::HostPool::Initialize( int numWorkers )
+{
+	CORE_ASSERT( m_workers == NULL );
+
+	if( numWorkers <= 0 )
+		numWorkers = core::NumHardwareThreads();
+
+	m_numWorkers = numWorkers;
+	m_workers = CORE_NEW HostWorker[ m_numWorkers ];
+
+	for( int i = 0; i < m_numWorkers; ++i )
+	{
+		HostWorker& worker = m_workers[ i ];
+		worker.pPool = this;
+		worker.index = i;
+		worker.thread.Start( &HostPool::WorkerEntry, &worker );
+	}
+}
+
+void csp::HostPool::Shutdown()
+{
+	core::AtomicStore( m_quit, 1 );
+	if( m_numWorkers > 0 )
+		m_tickStart.Signal( m_numWorkers );
+
+	for( int i = 0; i < m_numWorkers; ++i )
+		m_workers[ i ].thread.Join();
+
+	delete[] m_workers;
+	m_workers = NULL;
+	m_numWorkers = 0;
+
+	for( int i = 0; i < m_numHosts; ++i )
+	{
+		Host& host = *m_slots[ i ].pHost;
+		host.TerminateMain();
+		csp::Shutdown( host );
+	}
+
+	delete[] m_slots;
+	m_slots = NULL;
+	m_numHosts = 0;
+	m_capacity = 0;
+}
+
+csp::Host& csp::HostPool::CreateHost()
+{
+	if( m_numHosts == m_capacity )
+	{
+		int capacity = m_capacity > 0 ? m_capacity * 2 : HOST_POOL_INITIAL_CAPACITY;
+		HostSlot* slots = CORE_NEW HostSlot[ capacity ];
+		for( int i = 0; i < m_numHosts; ++i )
+			slots[ i ] = m_slots[ i ];
+
+		delete[] m_slots;
+		m_slots = slots;
+		m_capacity = capacity;
+	}
+
+	HostSlot& slot = m_slots[ m_numHosts ];
+	slot.pHost = &csp::Initialize();
+	slot.running = true;
+	slot.worker = m_numWorkers > 0 ? m_numHosts % m_numWorkers : 0;
+
+	++m_numHosts;
+	return *slot.pHost;
+}
+
+int csp::HostPool::NumHosts() const
+{
+	return m_numHosts;
+}
+
+int csp::HostPool::NumWorkers() const
+{
+	return m_numWorkers;
+}
+
+csp::Host& csp::HostPool::GetHost( int hostIndex )
+{
+	CORE_ASSERT( hostIndex >= 0 && hostIndex < m_numHosts );
+	return *m_slots[ hostIndex ].pHost;
+}
+
+bool csp::HostPool::IsHostRunning( int hostIndex ) const
+{
+	CORE_ASSERT( hostIndex >= 0 && hostIndex < m_numHosts );
+	return m_slots[ hostIndex ].running;
+}
+
+csp::CspTime_t csp::HostPool::HostWorkTime( int hostIndex ) const
+{
+	CORE_ASSERT( hostIndex >= 0 && hostIndex < m_numHosts );
+	return m_slots[ hostIndex ].workTime;
+}
+
+unsigned int csp::HostPool::HostNumSteals( int hostIndex ) const
+{
+	CORE_ASSERT( hostIndex >= 0 && hostIndex < m_numHosts );
+	return m_slots[ hostIndex ].numSteals;
+}
+
+csp::WorkResult::Enum csp::HostPool::Main()
+{
+	m_isMain = true;
+	m_dt = 0;
+	return RunTick();
+}
+
+csp::WorkResult::Enum csp::HostPool::Work( CspTime_t dt )
+{
+	m_isMain = false;
+	m_dt = dt;
+	return RunTick();
+}
+
+csp::WorkResult::Enum csp::HostPool::RunTick()
+{
+	CORE_ASSERT( m_numWorkers > 0 );
+
+	int numRunning = 0;
+	for( int i = 0; i < m_numWorkers; ++i )
+		m_workers[ i ].deque.Reserve( m_numHosts );
+
+	for( int i = 0; i < m_numHosts; ++i )
+	{
+		if( m_slots[ i ].running )
+			++numRunning;
+	}
+
+	if( numRunning == 0 )
+		return WorkResult::FINISH;
+
+	core::AtomicStore( m_numPending, numRunning );
+
+	for( int i = 0; i < m_numHosts; ++i )
+	{
+		HostSlot& slot = m_slots[ i ];
+		if( slot.running )
+			m_workers[ slot.worker ].deque.PushBack( i );
+	}
+
+	// the barrier: the last updated host signals the end of the tick
+	m_tickStart.Signal( m_numWorkers );
+	m_tickDone.Wait();
+
+	for( int i = 0; i < m_numHosts; ++i )
+	{
+		if( m_slots[ i ].running )
+			return WorkResult::YIELD;
+	}
+
+	return WorkResult::FINISH;
+}
+
+void csp::HostPool::WorkerEntry( void* pArgument )
+{
+	HostWorker& worker = *static_cast< HostWorker* >( pArgument );
+	worker.pPool->WorkerLoop( worker );
+}
+
+void csp::HostPool::WorkerLoop( HostWorker& worker )
+{
+	for(;;)
+	{
+		m_tickStart.Wait();
+		if( core::AtomicLoad( m_quit ) )
+			break;
+
+		int hostIndex;
+		while( PickHost( worker, hostIndex ) )
+			UpdateHost( worker, hostIndex );
+	}
+}
+
+bool csp::HostPool::PickHost( HostWorker& worker, int& hostIndex )
+{
+	if( worker.deque.PopBack( hostIndex ) )
+		return true;
+
+	for( int i = 1; i < m_numWorkers; ++i )
+	{
+		HostWorker& victim = m_workers[ ( worker.index + i ) % m_numWorkers ];
+		if( victim.deque.StealFront( hostIndex ) )
+		{
+			++m_slots[ hostIndex ].numSteals;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void csp::HostPool::UpdateHost( HostWorker& worker, int hostIndex )
+{
+	HostSlot& slot = m_slots[ hostIndex ];
+	slot.worker = worker.index;
+
+	double startTime = core::HighResolutionTime();
+
+	WorkResult::Enum result = m_isMain ? slot.pHost->Main() : slot.pHost->Work( m_dt );
+	slot.running = result == WorkResult::YIELD;
+
+	slot.workTime += core::HighResolutionTime() - startTime;
+
+	if( core::AtomicDecrement( m_numPending ) == 0 )
+		m_tickDone.Signal();
+}
@@ -0,0 +1,112 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <core/thread.h>
+
+#include "csp.h"
+
+namespace csp
+{
+	class HostPool;
+
+	// Per-worker queue of host indices. The owner pops from the back, thieves steal from the front.
+	class HostDeque
+	{
+	public:
+		HostDeque();
+		~HostDeque();
+
+		void Reserve( int capacity );
+
+		void PushBack( int hostIndex );
+		bool PopBack( int& hostIndex );
+		bool StealFront( int& hostIndex );
+
+	private:
+		core::Mutex m_mutex;
+		int* m_hosts;
+		int m_capacity;
+		int m_head;
+		int m_tail;
+	};
+
+	struct HostWorker
+	{
+		HostWorker();
+
+		HostPool* pPool;
+		int index;
+		core::Thread thread;
+		HostDeque deque;
+	};
+
+	struct HostSlot
+	{
+		HostSlot();
+
+		Host* pHost;
+		bool running;
+		int worker;
+		CspTime_t workTime;
+		unsigned int numSteals;
+	};
+
+	// Owns independent hosts (one lua_State each) and ticks them in parallel on a pool of worker threads.
+	// Each global tick is a barrier: Main() and Work() return once every running host has been updated.
+	// A host is queued on the worker which updated it last; idle workers steal hosts from others,
+	// so hosts migrate between threads to balance the load.
+	class HostPool
+	{
+	public:
+		HostPool();
+		~HostPool();
+
+		void Initialize( int numWorkers = 0 );
+		void Shutdown();
+
+		Host& CreateHost();
+
+		int NumHosts() const;
+		int NumWorkers() const;
+		Host& GetHost( int hostIndex );
+
+		WorkResult::Enum Main();
+		WorkResult::Enum Work( CspTime_t dt );
+
+		bool IsHostRunning( int hostIndex ) const;
+		CspTime_t HostWorkTime( int hostIndex ) const;
+		unsigned int HostNumSteals( int hostIndex ) const;
+
+	private:
+		HostPool( const HostPool& );
+		HostPool& operator=( const HostPool& );
+
+		static void WorkerEntry( void* pArgument );
+		void WorkerLoop( HostWorker& worker );
+		bool PickHost( HostWorker& worker, int& hostIndex );
+		void UpdateHost( HostWorker& worker, int hostIndex );
+
+		WorkResult::Enum RunTick();
+
+		HostWorker* m_workers;
+		int m_numWorkers;
+
+		HostSlot* m_slots;
+		int m_numHosts;
+		int m_capacity;
+
+		core::Semaphore m_tickStart;
+		core::Semaphore m_tickDone;
+		volatile long m_numPending;
+		volatile long m_quit;
+
+		bool m_isMain;
+		CspTime_t m_dt;
+	};
+}
@@ -17,25 +17,26 @@
 csp::OpAlt::OpAlt()
 	: m_cases()
 	, m_numCases( 0 )
+	, m_numOpenCases( 0 )
+	, m_pReadyCases()
+	, m_ppReadyTail( &m_pReadyCases )
+	, m_pCaseSelecting()
 	, m_pCaseTriggered()
 	, m_pNilCase()
-	, m_arguments()
+	, m_pTimeCase()
+	, m_timer()
 	, m_numArguments( CSP_NO_ARGS )
 	, m_argumentsMoved( false )
-	, m_processRefKey( lua::LUA_NO_REF )
 {
+	m_timer.SetAttachment( *this );
 }
 
 csp::OpAlt::~OpAlt()
 {
-	CORE_ASSERT( m_processRefKey == lua::LUA_NO_REF );
-
-	delete[] m_cases;
+	BlockAllocator::DeleteArray( m_cases );
 	m_cases = NULL;
 	m_numCases = 0;
 
-	delete[] m_arguments;
-	m_arguments = NULL;
 	m_numArguments = CSP_NO_ARGS;
 }
 
@@ -45,6 +46,8 @@ bool csp::OpAlt::Init( lua::LuaStack& args, InitError& initError )
 		return false;
 
 	InitCases( args );
+	ScheduleTimeCase( args );
+
 	return true;
 }
 
@@ -59,22 +62,14 @@ bool csp::OpAlt::CheckArgs( lua::LuaStack& args, InitError& initError ) const
 		lua::LuaStackValue guard = args[i];
 		lua::LuaStackValue closure = args[i+1];
 
-		Channel* pChannel = NULL;
-		if( IsChannelArg(guard) && ( pChannel = GetChannelArg(guard) ) != NULL ) 
-		{
-			if( pChannel->InAttached() )
-				return initError.ArgError( i, "channel is in input operation already" );
-		}
-		else if( guard.IsNumber() )
-		{
-		}
-		else if( guard.IsNil() )
+		if( guard.IsNil() )
 		{
 			if( nilCase )
 				return initError.ArgError( i, "there must be just one nil case" );
 			nilCase = true;
 		}
-		else
+		// channels may be shared with other readers
+		else if( !guard.IsNumber() && !( IsChannelArg(guard) && GetChannelArg(guard) != NULL ) )
 			return initError.ArgError( i, "channel, number or nil required as a guard" );
 
 		if( !closure.IsFunction() )
@@ -86,8 +81,7 @@ bool csp::OpAlt::CheckArgs( lua::LuaStack& args, InitError& initError ) const
 
 void csp::OpAlt::InitCases( lua::LuaStack& args )
 {
-	m_numCases = args.NumArgs()/2;
-	m_cases = CORE_NEW AltCase [ m_numCases ];
+	AllocateCases( args, args.NumArgs()/2 );
 
 	int initCase = 0;
 	for( int i = 1; i <= args.NumArgs(); i += 2 )
@@ -95,39 +89,82 @@ void csp::OpAlt::InitCases( lua::LuaStack& args )
 		lua::LuaStackValue guard = args[i];
 		lua::LuaStackValue closure = args[i+1];
 
+		AltCase& altCase = m_cases[ initCase ];
+
 		closure.PushValue();
-		m_cases[ initCase ].m_closureRefKey = args.RefInRegistry();
+		altCase.m_closureRefKey = args.RefInRegistry();
 
 		if( IsChannelArg(guard) )
 		{
+			guard.PushValue();
+			altCase.m_channelRefKey = args.RefInRegistry();
+
 			Channel* pChannel = GetChannelArg( guard );
 			CORE_ASSERT( pChannel != NULL );
-			pChannel->SetAttachmentIn( *this );
-
-			guard.PushValue();
-			m_cases[ initCase ].m_channelRefKey = args.RefInRegistry();
-			m_cases[ initCase ].m_pChannel = pChannel;
+			InitChannelCase( altCase, *pChannel );
 		}
 		else if( guard.IsNumber() )
 		{
-			m_cases[ initCase ].m_time = guard.GetNumber();
+			InitTimeCase( altCase, guard.GetNumber() );
 		}
 		else if( guard.IsNil() )
 		{
-			CORE_ASSERT( m_pNilCase == NULL );
-			m_pNilCase = m_cases + initCase;
+			InitNilCase( altCase );
 		}
 
 		++initCase;
 	}
 }
 
-void csp::OpAlt::UnrefArguments( lua::LuaStack const& stack )
+void csp::OpAlt::AllocateCases( lua::LuaStack& args, int numCases )
+{
+	CORE_ASSERT( m_cases == NULL );
+	m_numCases = numCases;
+	m_cases = Host::GetHost( args.InternalState() ).Allocator().NewArray< AltCase >( m_numCases );
+}
+
+void csp::OpAlt::InitChannelCase( AltCase& altCase, Channel& channel )
+{
+	altCase.m_waiter.SetIndex( (int)( &altCase - m_cases ) );
+	channel.AttachIn( altCase.m_waiter, *this );
+	altCase.m_pChannel = &channel;
+	++m_numOpenCases;
+
+	if( !channel.IsBufferEmpty() || channel.OutAttached() )
+		AddReadyCase( altCase );
+}
+
+void csp::OpAlt::InitTimeCase( AltCase& altCase, CspTime_t time )
 {
-	for( int i = 0; i < m_numArguments; ++i )
+	altCase.m_time = time;
+
+	if( m_pTimeCase == NULL || altCase.m_time < m_pTimeCase->m_time )
+		m_pTimeCase = &altCase;
+
+	if( altCase.m_time >= 0.0f )
+		++m_numOpenCases;
+}
+
+void csp::OpAlt::InitNilCase( AltCase& altCase )
+{
+	CORE_ASSERT( m_pNilCase == NULL );
+	m_pNilCase = &altCase;
+	AddReadyCase( altCase );
+}
+
+void csp::OpAlt::AddReadyCase( AltCase& altCase )
+{
+	altCase.m_pNextReady = NULL;
+	*m_ppReadyTail = &altCase;
+	m_ppReadyTail = &altCase.m_pNextReady;
+}
+
+void csp::OpAlt::ScheduleTimeCase( lua::LuaStack& args )
+{
+	if( m_pTimeCase )
 	{
-		stack.UnrefInRegistry( m_arguments[i].refKey );
-		m_arguments[i].refKey = lua::LUA_NO_REF;
+		Host& host = Host::GetHost( args.InternalState() );
+		host.Timers().Schedule( m_timer, m_pTimeCase->m_time );
 	}
 }
 
@@ -157,107 +194,97 @@ void csp::OpAlt::UnrefClosures( lua::LuaStack const& stack )
 	}
 }
 
-void csp::OpAlt::UnrefProcess( lua::LuaStack const& stack )
-{
-	if( m_processRefKey != lua::LUA_NO_REF )
-	{
-		stack.UnrefInRegistry( m_processRefKey );
-		m_processRefKey = lua::LUA_NO_REF;
-	}
-}
-
 bool csp::OpAlt::SelectChannelProcessToTrigger( Host& host )
 {
 	CORE_ASSERT( m_pCaseTriggered == NULL );
 
-	bool allCasesClosed = true;
+	// a case selected here is taken in this very evaluation: only a writer is woken up
 
-	for( int i = 0; i < m_numCases; ++i )
+	// a ready case may have gone stale since: its writer terminated or its channel closed
+	while( m_pReadyCases )
 	{
-		AltCase& altCase = m_cases[ i ];
+		AltCase& altCase = *m_pReadyCases;
+		m_pReadyCases = altCase.m_pNextReady;
+		altCase.m_pNextReady = NULL;
+
 		if( m_pNilCase == &altCase )
 		{
 			m_pCaseTriggered = m_pNilCase;
-			allCasesClosed = false;
 
 			m_argumentsMoved = true;
 			DetachChannels();
-
-			host.PushEvalStep( ThisProcess() );
-			break;
+			return false;
 		}
 
 		Channel* pChannel = altCase.m_pChannel;
-		if( pChannel || altCase.m_time >= 0.0f )
-			allCasesClosed = false;
+		if( pChannel && !pChannel->IsBufferEmpty() )
+		{
+			ReceiveFromBuffer( host, altCase );
+			return false;
+		}
 
 		if( pChannel && pChannel->OutAttached() )
 		{
 			ChannelAttachmentOut_i& out = pChannel->OutAttachment();
-			out.Communicate( host, ThisProcess() );
-			break;
+			m_pCaseSelecting = &altCase;
+			out.Communicate( host, *this );
+			m_pCaseSelecting = NULL;
+			return false;
 		}
 	}
 
-	return allCasesClosed;
+	return m_numOpenCases == 0;
 }
 
-void csp::OpAlt::SelectTimeProcessToTrigger( Host& host )
+void csp::OpAlt::ExpireTimer( Host& host )
 {
 	CORE_ASSERT( m_pCaseTriggered == NULL );
+	CORE_ASSERT( m_pTimeCase );
 
-	CspTime_t time = host.Time();
-
-	for( int i = 0; i < m_numCases; ++i )
-	{
-		AltCase& altCase = m_cases[ i ];
-		if( m_pNilCase == &altCase )
-			continue;
-
-		if( altCase.m_pChannel == NULL && altCase.m_time <= time )
-		{
-			if( m_pCaseTriggered )
-			{
-				if( altCase.m_time < m_pCaseTriggered->m_time )
-					m_pCaseTriggered = &altCase;
-			}
-			else
-				m_pCaseTriggered = &altCase;
-		}
-	}
-
-	if( m_pCaseTriggered )
-	{
-		m_argumentsMoved = true;
-		DetachChannels();
+	m_pCaseTriggered = m_pTimeCase;
+	m_argumentsMoved = true;
+	DetachChannels();
 
-		host.PushEvalStep( ThisProcess() );
-	}
+	host.PushEvalStep( ThisProcess() );
 }
 
-csp::WorkResult::Enum csp::OpAlt::StartTriggeredProcess( Host& host )
+int csp::OpAlt::PushResults( lua::LuaStack& luaStack )
 {
-	CORE_ASSERT( m_pCaseTriggered );
+	if( m_pCaseTriggered == NULL )
+		return 0;
 
-	lua::LuaStack& stack = host.LuaState().GetStack();
+	int numArguments = m_numArguments == CSP_NO_ARGS ? 0 : m_numArguments;
+	m_numArguments = CSP_NO_ARGS;
 
-	lua::LuaState thread = stack.NewThread();
+	// the closure goes below the received values: move it down value by value
+	luaStack.CheckStack( 2 );
+	int numCaseArguments = PushCaseClosure( luaStack, *m_pCaseTriggered );
+	int closureIndex = luaStack.GetTop() - numCaseArguments - numArguments;
+	for( int i = 0; i <= numCaseArguments; ++i )
+		luaStack.Insert( closureIndex );
 
-	stack.GetTopValue().PushValue();
-	m_processRefKey = stack.RefInRegistry();
+	UnrefClosures( luaStack );
+	UnrefChannels( luaStack );
 
-	m_process.SetLuaThread( thread );
-	m_process.SetParentProcess( ThisProcess() );
+	return 1 + numCaseArguments + numArguments;
+}
 
-	lua::LuaStack threadStack = thread.GetStack();
-	threadStack.PushRegistryReferenced( m_pCaseTriggered->m_closureRefKey );
-	for( int i = 0; i < m_numArguments; ++i )
-		threadStack.PushRegistryReferenced( m_arguments[i].refKey );
+lua::CFunction_t csp::OpAlt::Continuation() const
+{
+	return CallTriggeredClosure;
+}
 
-	int numArguments = m_numArguments == CSP_NO_ARGS ? 0 : m_numArguments;
-	WorkResult::Enum result = m_process.StartEvaluation( host, numArguments );
-	UnrefClosures( stack );
-	return result;
+int csp::OpAlt::CallTriggeredClosure( lua_State* luaState )
+{
+	lua::LuaStack stack( luaState );
+
+	// the closure and its arguments are above the ALT arguments, nothing is there if all cases closed.
+	// a closure which blocks on an operation suspends the calling process, then comes back here.
+	int numAltArguments = stack.Context();
+	if( stack.GetTop() > numAltArguments )
+		stack.Call( stack.GetTop() - numAltArguments - 1, 0, numAltArguments, CallTriggeredClosure );
+
+	return 0;
 }
 
 
@@ -269,126 +296,134 @@ csp::WorkResult::Enum csp::OpAlt::Evaluate( Host& host )
 	{
 		bool allCasesClosed = SelectChannelProcessToTrigger( host );
 		if( allCasesClosed )
-			return WorkResult::FINISH;
-	}
-	else
-	{
-		if( m_argumentsMoved )
 		{
-			m_argumentsMoved = false;
-
-			StartTriggeredProcess( host );
-
-			UnrefArguments( stack );
-			UnrefChannels( stack );			
-		}
-		else if( m_process.IsRunning() )
-		{
-		}
-		else if( m_processRefKey != lua::LUA_NO_REF )
-		{
-			UnrefProcess( stack );
+			UnrefChannels( stack );
+			UnrefClosures( stack );
 			return WorkResult::FINISH;
 		}
+
+		if( m_pCaseTriggered == NULL )
+			return WorkResult::YIELD;
 	}
 
-	return WorkResult::YIELD;
+	CORE_ASSERT( m_argumentsMoved );
+	m_argumentsMoved = false;
+	host.Timers().Cancel( m_timer );
+
+	// the closure is called by the ALT caller itself, see PushResults
+	return WorkResult::FINISH;
 }
 
-csp::WorkResult::Enum csp::OpAlt::Work( Host& host, CspTime_t dt )
+csp::WorkResult::Enum csp::OpAlt::Work( Host&, CspTime_t )
 {
-	if( m_pCaseTriggered )
-	{
-		if( m_process.IsRunning() )
-			m_process.Work( host, dt );
-	}
-	else
-		SelectTimeProcessToTrigger( host );
-
 	return IsFinished() ? WorkResult::FINISH : WorkResult::YIELD;
 }
 
+bool csp::OpAlt::RequiresWork() const
+{
+	// woken up by channels and the timer queue
+	return false;
+}
+
 
-csp::OpAlt::AltCase* csp::OpAlt::FindCaseForChannel( Channel& channel ) const
+csp::OpAlt::AltCase& csp::OpAlt::CaseForChannel( Channel& channel ) const
 {
-	AltCase* pCaseTriggered = NULL;
-	for( int i = 0; i < m_numCases && pCaseTriggered == NULL; ++i )
-	{
-		if( m_cases[ i ].m_pChannel == &channel )
-			pCaseTriggered = m_cases + i;
-	}
-	
-	return pCaseTriggered;
+	if( m_pCaseSelecting )
+		return *m_pCaseSelecting;
+
+	int index = channel.InWaiter().Index();
+	CORE_ASSERT( index >= 0 && index < m_numCases );
+	CORE_ASSERT( m_cases[ index ].m_pChannel == &channel );
+	return m_cases[ index ];
 }
 
-void csp::OpAlt::MoveChannelArguments( Channel& channel, ChannelArgument* arguments, int numArguments )
+void csp::OpAlt::MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments )
 {
-	CORE_ASSERT( m_arguments == NULL );
 	CORE_ASSERT( m_numArguments == CSP_NO_ARGS );
 	CORE_ASSERT( numArguments != CSP_NO_ARGS );
 
-	AltCase* pCaseTriggered = FindCaseForChannel( channel );
-
-	CORE_ASSERT( pCaseTriggered );
 	CORE_ASSERT( m_pCaseTriggered == NULL );
-	m_pCaseTriggered = pCaseTriggered;
+	m_pCaseTriggered = &CaseForChannel( channel );
 
-	m_arguments = arguments;
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	stack.CheckStack( numArguments );
+	fromStack.XMove( stack, numArguments );
 	m_numArguments = numArguments;
 	
 	m_argumentsMoved = true;
 	DetachChannels();
 }
 
+void csp::OpAlt::ReceiveFromBuffer( Host& host, AltCase& altCase )
+{
+	CORE_ASSERT( m_numArguments == CSP_NO_ARGS );
+	CORE_ASSERT( m_pCaseTriggered == NULL );
+	m_pCaseTriggered = &altCase;
+
+	lua::LuaStack& stack = ThisProcess().LuaThread().GetStack();
+	stack.CheckStack( 2 );
+	PushCaseChannel( stack, altCase );
+	int bufferIndex = Channel::PushBuffer( stack.GetTopValue() ).Index();
+	stack.Remove( bufferIndex - 1 );
+	--bufferIndex;
+	m_numArguments = altCase.m_pChannel->PopMessage( host, stack, bufferIndex );
+	stack.Remove( bufferIndex );
+
+	m_argumentsMoved = true;
+	DetachChannels();
+}
+
+int csp::OpAlt::PushCaseClosure( lua::LuaStack& stack, AltCase& altCase )
+{
+	stack.PushRegistryReferenced( altCase.m_closureRefKey );
+	return 0;
+}
+
+void csp::OpAlt::PushCaseChannel( lua::LuaStack& stack, AltCase& altCase )
+{
+	stack.PushRegistryReferenced( altCase.m_channelRefKey );
+}
+
 csp::Process& csp::OpAlt::ProcessToEvaluate()
 {
 	return ThisProcess();
 }
 
-void csp::OpAlt::DetachChannels() const
+void csp::OpAlt::DetachChannels()
 {
 	for( int i = 0; i < m_numCases; ++i )
 	{
 		if( m_cases[i].m_pChannel )
-			m_cases[i].m_pChannel->ResetAttachmentIn( *this );
+			m_cases[i].m_pChannel->DetachIn( m_cases[i].m_waiter );
 	}
 }
 
-void csp::OpAlt::DebugCheck( Host& host ) const
-{
-	(void)host;
-	CORE_ASSERT( !host.DebugIsProcessOnStack( m_process ) );
-}
-
 void csp::OpAlt::Terminate( Host& host )
 {
 	lua::LuaStack stack = host.LuaState().GetStack();
 
-	m_process.Terminate( host );
+	host.Timers().Cancel( m_timer );
 
 	DetachChannels();
 	UnrefChannels( stack );
-	UnrefArguments( stack );
 	UnrefClosures( stack );
-	UnrefProcess( stack );
 }
 
 void csp::OpAlt::CloseChannel( csp::Host & host, Channel& channel )
 {
-	AltCase* pCaseClosed = FindCaseForChannel( channel );
-	CORE_ASSERT( pCaseClosed );
-	CORE_ASSERT( pCaseClosed->m_pChannel != NULL );
+	AltCase& caseClosed = CaseForChannel( channel );
+	CORE_ASSERT( caseClosed.m_pChannel != NULL );
 
-	CloseCase( host.LuaState().GetStack(), *pCaseClosed );
-	channel.ResetAttachmentIn( *this );
+	CloseCase( host.LuaState().GetStack(), caseClosed );
 }
 
 void csp::OpAlt::CloseCase( lua::LuaStack& stack, AltCase& altCase )
 {
 	if( altCase.m_pChannel )
 	{
-		altCase.m_pChannel->ResetAttachmentIn( *this );
+		altCase.m_pChannel->DetachIn( altCase.m_waiter );
 		altCase.m_pChannel = NULL;
+		--m_numOpenCases;
 	}
 
 	if( altCase.m_channelRefKey != lua::LUA_NO_REF )
@@ -407,7 +442,114 @@ void csp::OpAlt::CloseCase( lua::LuaStack& stack, AltCase& altCase )
 csp::OpAlt::AltCase::AltCase()
 	: m_closureRefKey( lua::LUA_NO_REF )
 	, m_pChannel()
+	, m_waiter()
 	, m_channelRefKey( lua::LUA_NO_REF )
 	, m_time( -1 )
+	, m_pNextReady()
+{
+}
+
+
+csp::OpAltArray::OpAltArray()
+	: m_handlerRefKey( lua::LUA_NO_REF )
+	, m_channelsRefKey( lua::LUA_NO_REF )
+	, m_numChannels( 0 )
+{
+}
+
+csp::OpAltArray::~OpAltArray()
+{
+	CORE_ASSERT( m_handlerRefKey == lua::LUA_NO_REF );
+	CORE_ASSERT( m_channelsRefKey == lua::LUA_NO_REF );
+}
+
+bool csp::OpAltArray::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !CheckArgs( args, initError ) )
+		return false;
+
+	lua::LuaStackValue channels = args[1];
+	bool hasTimeout = args.NumArgs() >= 3 && args[3].IsNumber();
+
+	m_numChannels = (int)channels.RawLength();
+	AllocateCases( args, m_numChannels + ( hasTimeout ? 1 : 0 ) );
+
+	lua::LuaStackValue channelsCopy = args.PushTable( m_numChannels );
+	for( int i = 0; i < m_numChannels; ++i )
+	{
+		lua::LuaStackValue channel = channels.PushRawGetIndex( i+1 );
+		InitChannelCase( m_cases[ i ], *GetChannelArg( channel ) );
+		channelsCopy.RawSetIndex( i+1 );
+	}
+	m_channelsRefKey = args.RefInRegistry();
+
+	args[2].PushValue();
+	m_handlerRefKey = args.RefInRegistry();
+
+	if( hasTimeout )
+		InitTimeCase( m_cases[ m_numChannels ], args[3].GetNumber() );
+	ScheduleTimeCase( args );
+
+	return true;
+}
+
+bool csp::OpAltArray::CheckArgs( lua::LuaStack& args, InitError& initError ) const
+{
+	lua::LuaStackValue channels = args[1];
+	if( !channels.IsTable() )
+		return initError.ArgError( 1, "array of channels required" );
+
+	if( !args[2].IsFunction() )
+		return initError.ArgError( 2, "handler required" );
+
+	if( args.NumArgs() >= 3 && !args[3].IsNil() && !args[3].IsNumber() )
+		return initError.ArgError( 3, "number required as a time guard" );
+
+	int numChannels = (int)channels.RawLength();
+	for( int i = 1; i <= numChannels; ++i )
+	{
+		lua::LuaStackValue channel = channels.PushRawGetIndex( i );
+		bool isChannel = IsChannelArg( channel ) && GetChannelArg( channel ) != NULL;
+		args.Pop( 1 );
+
+		if( !isChannel )
+			return initError.ArgError( 1, "array of channels required" );
+	}
+
+	return true;
+}
+
+void csp::OpAltArray::UnrefChannels( lua::LuaStack const& stack )
+{
+	OpAlt::UnrefChannels( stack );
+
+	stack.UnrefInRegistry( m_channelsRefKey );
+	m_channelsRefKey = lua::LUA_NO_REF;
+}
+
+void csp::OpAltArray::UnrefClosures( lua::LuaStack const& stack )
+{
+	OpAlt::UnrefClosures( stack );
+
+	stack.UnrefInRegistry( m_handlerRefKey );
+	m_handlerRefKey = lua::LUA_NO_REF;
+}
+
+int csp::OpAltArray::PushCaseClosure( lua::LuaStack& stack, AltCase& altCase )
+{
+	stack.PushRegistryReferenced( m_handlerRefKey );
+
+	int index = (int)( &altCase - m_cases );
+	if( index >= m_numChannels )
+		return 0;
+
+	stack.PushInteger( index+1 );
+	return 1;
+}
+
+void csp::OpAltArray::PushCaseChannel( lua::LuaStack& stack, AltCase& altCase )
 {
+	stack.PushRegistryReferenced( m_channelsRefKey );
+	stack.GetTopValue().PushRawGetIndex( (int)( &altCase - m_cases ) + 1 );
+	stack.Remove( stack.GetTop() - 1 );
 }
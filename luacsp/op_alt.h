@@ -8,64 +8,119 @@
 #pragma once
 
 #include "operation.h"
+#include "channel.h"
 
 namespace csp
 {
-	class OpAlt : public Operation, ChannelAttachmentIn_i
+	class OpAlt : public Operation, ChannelAttachmentIn_i, TimerAttachment_i
 	{
 	public:
 		OpAlt();
 		virtual ~OpAlt();
 
+		struct AltCase
+		{
+			AltCase();
+
+			lua::LuaRef_t m_closureRefKey;
+
+			Channel* m_pChannel;
+			ChannelWaiter m_waiter;
+			lua::LuaRef_t m_channelRefKey;
+			CspTime_t m_time;				
+
+			AltCase* m_pNextReady;
+		};
+
+	protected:
+		void AllocateCases( lua::LuaStack& args, int numCases );
+		void InitChannelCase( AltCase& altCase, Channel& channel );
+		void InitTimeCase( AltCase& altCase, CspTime_t time );
+		void InitNilCase( AltCase& altCase );
+		void ScheduleTimeCase( lua::LuaStack& args );
+
+		virtual void UnrefChannels( lua::LuaStack const& stack );
+		virtual void UnrefClosures( lua::LuaStack const& stack );
+
+		AltCase* m_cases;
+		int m_numCases;
+
 	private:
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 		virtual void Terminate( Host& host );
 
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		bool CheckArgs( lua::LuaStack& args, InitError& initError ) const;
 		void InitCases( lua::LuaStack& args );
+		void AddReadyCase( AltCase& altCase );
+
+		void DetachChannels();
 
-		void DetachChannels() const;
-		void UnrefChannels( lua::LuaStack const& stack );
-		void UnrefArguments( lua::LuaStack const& stack );
-		void UnrefClosures( lua::LuaStack const& stack );
-		void UnrefProcess( lua::LuaStack const& stack );
+		virtual int PushResults( lua::LuaStack& luaStack );
+		virtual lua::CFunction_t Continuation() const;
+		// Calls the triggered closure on the ALT caller thread: no thread nor process per event.
+		static int CallTriggeredClosure( lua_State* luaState );
 
-		WorkResult::Enum StartTriggeredProcess( Host& host );
 		bool SelectChannelProcessToTrigger( Host& host );
-		void SelectTimeProcessToTrigger( Host& host );
 
-		virtual void MoveChannelArguments( Channel& channel, ChannelArgument* arguments, int numArguments );
+		// Pushes the closure of the case and its leading arguments, returns the number of arguments.
+		virtual int PushCaseClosure( lua::LuaStack& stack, AltCase& altCase );
+		virtual void PushCaseChannel( lua::LuaStack& stack, AltCase& altCase );
+
+		virtual void MoveChannelArguments( Channel& channel, lua::LuaStack& fromStack, int numArguments );
 		virtual Process& ProcessToEvaluate();
 		virtual void CloseChannel( csp::Host & host, Channel& channel );
 
-		virtual void DebugCheck( Host& host ) const;
+		virtual void ExpireTimer( Host& host );
 
-		struct AltCase
-		{
-			AltCase();
 
-			lua::LuaRef_t m_closureRefKey;
+		int m_numOpenCases;
 
-			Channel* m_pChannel;
-			lua::LuaRef_t m_channelRefKey;
-			CspTime_t m_time;				
-		};
-		AltCase* m_cases;
-		int m_numCases;
+		// Cases found ready on start, in guard order. Cases getting ready later are triggered
+		// by their writers, which always serve the first reader waiting.
+		AltCase* m_pReadyCases;
+		AltCase** m_ppReadyTail;
+		// The case whose writer is asked to communicate by the ALT itself.
+		AltCase* m_pCaseSelecting;
 
-		AltCase* FindCaseForChannel( Channel& channel ) const;
+		AltCase& CaseForChannel( Channel& channel ) const;
 		void CloseCase( lua::LuaStack& stack, AltCase& altCase );
+		void ReceiveFromBuffer( Host& host, AltCase& altCase );
 
 		AltCase* m_pCaseTriggered;
 		AltCase* m_pNilCase;
+		AltCase* m_pTimeCase;
 
-		Process m_process;
-		lua::LuaRef_t m_processRefKey;
+		Timer m_timer;
 
-		ChannelArgument* m_arguments;
+		// received values wait on top of this process stack until they are passed to the triggered closure
 		int m_numArguments;
 		bool m_argumentsMoved;
 	};
+
+	// ALT_ARRAY( channels, handler [, time] ) calls handler( index, ... ) for the channel which fired,
+	// or handler() once the time guard expires, as ALT time guards do. Holds two registry refs whatever the number of channels: the handler
+	// and a copy of the array, which keeps the channels alive even if the caller changes its table.
+	class OpAltArray : public OpAlt
+	{
+	public:
+		OpAltArray();
+		virtual ~OpAltArray();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		bool CheckArgs( lua::LuaStack& args, InitError& initError ) const;
+
+		virtual void UnrefChannels( lua::LuaStack const& stack );
+		virtual void UnrefClosures( lua::LuaStack const& stack );
+
+		virtual int PushCaseClosure( lua::LuaStack& stack, AltCase& altCase );
+		virtual void PushCaseChannel( lua::LuaStack& stack, AltCase& altCase );
+
+		lua::LuaRef_t m_handlerRefKey;
+		lua::LuaRef_t m_channelsRefKey;
+		int m_numChannels;
+	};
 }
\ No newline at end of file
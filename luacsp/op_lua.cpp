@@ -172,7 +172,7 @@ int csp::OpLua_new( lua_State* luaState )
 
 int csp::OpLua_Init( lua_State* luaState )
 {
-	OpLua* pOpLua = CORE_NEW OpLua();
+	OpLua* pOpLua = new( Host::GetHost( luaState ) ) OpLua();
 	return pOpLua->DoInit( luaState );
 }
 
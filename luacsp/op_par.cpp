@@ -43,18 +43,18 @@ bool csp::OpPar::Init( lua::LuaStack& args, InitError& initError )
 
 	m_closures = CORE_NEW ParClosure[ m_numClosures ];
 
+	CoroutinePool& coroutines = Host::GetHost( args.InternalState() ).Coroutines();
 	for( int i = 1; i <= args.NumArgs(); ++i )
 	{
 		lua::LuaStackValue arg = args[i];
 		ParClosure& closure = m_closures[ i-1 ];
+		closure.refKey = lua::LUA_NO_REF;
 
-		lua::LuaState thread = args.NewThread();
+		lua::LuaState thread = coroutines.Acquire( closure.process, closure.refKey );
 		arg.PushValue();
 		args.XMove( thread.GetStack(), 1 );
 
-		closure.process.SetLuaThread( thread );
 		closure.process.SetParentProcess( ThisProcess() );
-		closure.refKey = args.RefInRegistry();
 	}
 
 	return true;
@@ -76,7 +76,7 @@ csp::WorkResult::Enum csp::OpPar::Evaluate( Host& host )
 		closure.process.StartEvaluation( host, 0 );
 	}
 
-	if ( !CheckFinished() )
+	if ( !CheckFinished( host ) )
 		finished = false;
 
 	if ( finished )
@@ -85,19 +85,18 @@ csp::WorkResult::Enum csp::OpPar::Evaluate( Host& host )
 	return IsFinished() ? WorkResult::FINISH : WorkResult::YIELD;
 }
 
-csp::WorkResult::Enum csp::OpPar::Work( Host& host, CspTime_t dt )
+csp::WorkResult::Enum csp::OpPar::Work( Host&, CspTime_t )
 {
-	for( int i = m_closureToRun-1; i >= 0; --i )
-	{
-		Process& process = m_closures[ i ].process;
-		if( process.IsRunning() )
-			process.Work( host, dt );
-	}
-
 	return IsFinished() ? WorkResult::FINISH : WorkResult::YIELD;
 }
 
-bool csp::OpPar::CheckFinished()
+bool csp::OpPar::RequiresWork() const
+{
+	// sub-processes are updated by the host directly
+	return false;
+}
+
+bool csp::OpPar::CheckFinished( Host& host )
 {
 	bool finished = true;
 	for( int i = 0; i < m_closureToRun; ++i )
@@ -107,10 +106,9 @@ bool csp::OpPar::CheckFinished()
 		{
 			finished = false;
 		}
-		else if( m_closures[ i ].refKey != lua::LUA_NO_REF )
+		else
 		{
-			ThisProcess().LuaThread().GetStack().UnrefInRegistry( m_closures[ i ].refKey );
-			m_closures[ i ].refKey = lua::LUA_NO_REF;
+			host.Coroutines().Release( process, m_closures[ i ].refKey );
 		}
 	}
 	return finished;
@@ -128,16 +126,10 @@ void csp::OpPar::DebugCheck( Host& host ) const
 #endif
 }
 
-void csp::OpPar::UnrefClosures()
+void csp::OpPar::UnrefClosures( Host& host )
 {
 	for( int i = 0; i < m_numClosures; ++i )
-	{
-		if( m_closures[ i ].refKey != lua::LUA_NO_REF )
-		{
-			ThisProcess().LuaThread().GetStack().UnrefInRegistry( m_closures[ i ].refKey );
-			m_closures[ i ].refKey = lua::LUA_NO_REF;
-		}
-	}
+		host.Coroutines().Release( m_closures[ i ].process, m_closures[ i ].refKey );
 }
 
 void csp::OpPar::Terminate( Host& host )
@@ -146,7 +138,7 @@ void csp::OpPar::Terminate( Host& host )
 	{
 		m_closures[ i ].process.Terminate( host );
 	}
-	UnrefClosures();
+	UnrefClosures( host );
 }
 
 
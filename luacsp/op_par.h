@@ -19,11 +19,12 @@ namespace csp
 
 	protected:
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
-		bool CheckFinished();
-		void UnrefClosures();
+		bool CheckFinished( Host& host );
+		void UnrefClosures( Host& host );
 
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 		virtual void Terminate( Host& host );
 
 		virtual void DebugCheck( Host& host ) const;
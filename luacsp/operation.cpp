@@ -26,6 +26,40 @@ csp::Operation::~Operation()
 {
 }
 
+void* csp::Operation::operator new( size_t size, Host& host )
+{
+	return host.Allocator().Allocate( size );
+}
+
+void* csp::Operation::operator new( size_t size )
+{
+	return BlockAllocator::AllocateFromHeap( size );
+}
+
+#ifdef _DEBUG
+void* csp::Operation::operator new( size_t size, int, const char*, int )
+{
+	return BlockAllocator::AllocateFromHeap( size );
+}
+#endif
+
+void csp::Operation::operator delete( void* pMemory, Host& )
+{
+	BlockAllocator::Free( pMemory );
+}
+
+void csp::Operation::operator delete( void* pMemory )
+{
+	BlockAllocator::Free( pMemory );
+}
+
+#ifdef _DEBUG
+void csp::Operation::operator delete( void* pMemory, int, const char*, int )
+{
+	BlockAllocator::Free( pMemory );
+}
+#endif
+
 int csp::Operation::PushResults( lua::LuaStack & )
 {
 	// empty by default
@@ -57,8 +91,10 @@ int csp::Operation::DoInit( lua_State* luaState )
 		return state.GetStack().ArgError( initError.errorArg, initError.errorMessage );
 	}
 
-	m_pProcess->SwitchCurrentOperation( this );
-	return state.Yield( 0 );
+	m_pProcess->SwitchCurrentOperation( Host::GetHost( luaState ), this );
+
+	int numRetainedValues = NumRetainedValues();
+	return state.Yield( numRetainedValues, args.GetTop() - numRetainedValues, Continuation() );
 }
 
 bool csp::Operation::Init( lua::LuaStack &, InitError& )
@@ -67,6 +103,16 @@ bool csp::Operation::Init( lua::LuaStack &, InitError& )
 	return true;
 }
 
+int csp::Operation::NumRetainedValues() const
+{
+	return 0;
+}
+
+lua::CFunction_t csp::Operation::Continuation() const
+{
+	return NULL;
+}
+
 bool csp::Operation::IsFinished() const
 {
 	return m_finished;
@@ -83,6 +129,12 @@ csp::WorkResult::Enum csp::Operation::Evaluate( Host& )
 	return WorkResult::YIELD;
 }
 
+bool csp::Operation::RequiresWork() const
+{
+	// operations are updated every tick by default
+	return true;
+}
+
 void csp::Operation::DebugCheck( Host& ) const
 {
 	// empty by default
@@ -114,8 +166,9 @@ bool csp::Operation::InitError::Error( const char* message )
 
 
 csp::OpSleep::OpSleep()
-	: m_seconds()
+	: m_timer()
 {
+	m_timer.SetAttachment( *this );
 }
 
 bool csp::OpSleep::Init( lua::LuaStack & args, InitError& initError )
@@ -123,14 +176,31 @@ bool csp::OpSleep::Init( lua::LuaStack & args, InitError& initError )
 	if ( !args[1].IsNumber() )
 		return initError.ArgError( 1, "seconds expected" );
 
-	m_seconds = args[1].GetNumber();
+	Host& host = Host::GetHost( args.InternalState() );
+	host.Timers().Schedule( m_timer, host.Time() + args[1].GetNumber() );
 	return true;
 }
 
-csp::WorkResult::Enum csp::OpSleep::Work( Host&, CspTime_t dt )
+csp::WorkResult::Enum csp::OpSleep::Work( Host&, CspTime_t )
+{
+	// the host timer queue wakes us up.
+	return WorkResult::YIELD;
+}
+
+bool csp::OpSleep::RequiresWork() const
 {
-	m_seconds -= dt;
-	return m_seconds > 0 ? WorkResult::YIELD : WorkResult::FINISH;
+	return false;
+}
+
+void csp::OpSleep::Terminate( Host& host )
+{
+	host.Timers().Cancel( m_timer );
+}
+
+void csp::OpSleep::ExpireTimer( Host& host )
+{
+	SetFinished( true );
+	host.PushEvalStep( ThisProcess() );
 }
 
 
@@ -140,29 +210,36 @@ namespace operations
 	int PAR( lua_State* luaState );
 	int PARWHILE( lua_State* luaState );
 	int ALT( lua_State* luaState );
+	int ALT_ARRAY( lua_State* luaState );
 }
 
 int operations::SLEEP( lua_State* luaState )
 {
-	csp::OpSleep* pSleep = CORE_NEW csp::OpSleep();
+	csp::OpSleep* pSleep = new( csp::Host::GetHost( luaState ) ) csp::OpSleep();
 	return pSleep->DoInit( luaState );
 }
 
 int operations::PAR( lua_State* luaState )
 {
-	csp::OpPar* pPar = CORE_NEW csp::OpPar();
+	csp::OpPar* pPar = new( csp::Host::GetHost( luaState ) ) csp::OpPar();
 	return pPar->DoInit( luaState );
 }
 
 int operations::PARWHILE( lua_State* luaState )
 {
-	csp::OpParWhile* pPar = CORE_NEW csp::OpParWhile();
+	csp::OpParWhile* pPar = new( csp::Host::GetHost( luaState ) ) csp::OpParWhile();
 	return pPar->DoInit( luaState );
 }
 
 int operations::ALT( lua_State* luaState )
 {
-	csp::OpAlt* pAlt = CORE_NEW csp::OpAlt();
+	csp::OpAlt* pAlt = new( csp::Host::GetHost( luaState ) ) csp::OpAlt();
+	return pAlt->DoInit( luaState );
+}
+
+int operations::ALT_ARRAY( lua_State* luaState )
+{
+	csp::OpAltArray* pAlt = new( csp::Host::GetHost( luaState ) ) csp::OpAltArray();
 	return pAlt->DoInit( luaState );
 }
 
@@ -172,6 +249,7 @@ const csp::FunctionRegistration operationDescriptions[] =
 	, "PAR", operations::PAR
 	, "PARWHILE", operations::PARWHILE
 	, "ALT", operations::ALT
+	, "ALT_ARRAY", operations::ALT_ARRAY
 	, NULL, NULL
 };
 
@@ -9,6 +9,7 @@
 
 #include "csp.h"
 #include "process.h"
+#include "timer.h"
 
 namespace lua
 {
@@ -30,11 +31,25 @@ namespace csp
 		Operation();
 		virtual ~Operation();
 
+		// Operations are allocated from the host pools: new( host ) OpSomething().
+		// Plain new and CORE_NEW still work and allocate from the global heap.
+		static void* operator new( size_t size, Host& host );
+		static void* operator new( size_t size );
+#ifdef _DEBUG
+		static void* operator new( size_t size, int blockType, const char* fileName, int line );
+#endif
+		static void operator delete( void* pMemory, Host& host );
+		static void operator delete( void* pMemory );
+#ifdef _DEBUG
+		static void operator delete( void* pMemory, int blockType, const char* fileName, int line );
+#endif
+
 		int DoInit( lua_State* luaState );
 		void DoTerminate( Host& host );
 
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt ) = 0;
+		virtual bool RequiresWork() const;
 		
 		virtual int PushResults( lua::LuaStack& luaStack );
 
@@ -58,12 +73,17 @@ namespace csp
     private:
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		virtual void Terminate( Host& host );
+		// Number of values on top of the stack which stay on the suspended thread while the operation runs.
+		virtual int NumRetainedValues() const;
+		// Continues the operation call on the resumed thread, with the values of PushResults
+		// on top of the call arguments. NULL returns the values to the caller.
+		virtual lua::CFunction_t Continuation() const;
 
 		Process* m_pProcess;
 		bool m_finished;
     };
 
-	class OpSleep : public Operation
+	class OpSleep : public Operation, TimerAttachment_i
 	{
 	public:
 		OpSleep();
@@ -71,8 +91,12 @@ namespace csp
 	private:
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
+		virtual void Terminate( Host& host );
+
+		virtual void ExpireTimer( Host& host );
 
-		csp::CspTime_t m_seconds;
+		Timer m_timer;
 	};
 
 	void RegisterStandardOperations( lua::LuaState& state, lua::LuaStackValue& value );
@@ -15,8 +15,11 @@
 csp::Process::Process()
 	: m_luaThread()
 	, m_parentProcess()
+	, m_pParentAttachment()
 	, m_operation()
 	, m_isOnStack( false )
+	, m_preempted( false )
+	, m_threadDetached( false )
 {
 }
 
@@ -41,15 +44,21 @@ void csp::Process::SetProcess( lua_State* luaState, Process* process )
 	lua::LuaState::SetUserData( luaState, process );
 }
 
-void csp::Process::SwitchCurrentOperation( Operation* pOperation )
+void csp::Process::SwitchCurrentOperation( Host& host, Operation* pOperation )
 {
 	if( m_operation )
 	{
+		if( m_operation->RequiresWork() )
+			host.RemoveFromWorkSet( *this );
+
 		delete m_operation;
 		m_operation = NULL;
 	}
 
 	m_operation = pOperation;
+
+	if( m_operation && m_operation->RequiresWork() )
+		host.AddToWorkSet( *this );
 }
 
 bool csp::Process::IsInOperation() const
@@ -108,29 +117,61 @@ csp::WorkResult::Enum csp::Process::Evaluate( Host& host, int numArgs )
 			return WorkResult::YIELD;
 	}
 	
-	WorkResult::Enum result = Resume( numArgs );
+	WorkResult::Enum result = Resume( host, numArgs );
 	
 	if ( result == WorkResult::YIELD && m_operation )
 		host.PushEvalStep( *this );
+	else if ( result == WorkResult::YIELD && m_preempted )
+		host.PushPreempted( *this );
+	else if ( result == WorkResult::FINISH && m_pParentAttachment )
+	{
+		m_pParentAttachment->ChildFinished( host, *this );
+	}
 	else if ( result == WorkResult::FINISH && m_parentProcess )
 	{
-		if( !m_parentProcess->IsOnStack() )
-			host.PushEvalStep( *m_parentProcess );
+		host.PushEvalStepFirst( *m_parentProcess );
 	}
 
 	return result;
 }
 
 
-csp::WorkResult::Enum csp::Process::Resume( int numArgs )
+csp::WorkResult::Enum csp::Process::Resume( Host& host, int numArgs )
 {
+	Process* pPrevRunning = host.RunningProcess();
+	host.SetRunningProcess( this );
+
+	int hookInterval = host.PreemptionHookInterval();
+	LuaThread().SetCountHook( hookInterval > 0 ? &Process::PreemptionHook : NULL, hookInterval );
+
 	lua::Return::Enum retValue = LuaThread().Resume( numArgs, m_parentProcess ? &m_parentProcess->LuaThread() : NULL );
+
+	host.SetRunningProcess( pPrevRunning );
+
 	if( retValue == lua::Return::YIELD )
 		return WorkResult::YIELD;
 
 	return WorkResult::FINISH;
 }
 
+void csp::Process::PreemptionHook( lua_State* luaState, lua_Debug* )
+{
+	Host& host = Host::GetHost( luaState );
+	if( !host.ConsumeInstructionBudget() )
+		return;
+
+	// Coroutines created by the process inherit the hook: only the resumed process thread itself can be preempted.
+	Process* pProcess = host.RunningProcess();
+	if( pProcess == NULL || pProcess->LuaThread().InternalState() != luaState )
+		return;
+
+	if( pProcess->IsInOperation() || !pProcess->LuaThread().IsYieldable() )
+		return;
+
+	pProcess->SetPreempted( true );
+	pProcess->LuaThread().Yield( 0 );
+}
+
 void csp::Process::DoTerminate( Host& host )
 {
 	Terminate( host );
@@ -146,6 +187,9 @@ void csp::Process::Terminate( Host& host )
 	
 	if( IsOnStack() )
 		host.RemoveProcessFromStack( *this );
+
+	if( IsPreempted() )
+		host.RemovePreempted( *this );
 }
 
 void csp::Process::DeleteOperation( Host& host )
@@ -153,23 +197,35 @@ void csp::Process::DeleteOperation( Host& host )
 	CORE_ASSERT( m_operation );
 
 	m_operation->DebugCheck( host );
-	SwitchCurrentOperation( NULL );
+	SwitchCurrentOperation( host, NULL );
 }
 
 bool csp::Process::IsRunning() const
 {
+	if( m_threadDetached )
+		return false;
+
 	return m_operation != NULL || m_luaThread.InternalState() == NULL || m_luaThread.Status() == lua::Return::YIELD;
 }
 
 void csp::Process::SetLuaThread( const lua::LuaState& luaThread )
 {
 	m_luaThread = luaThread;
+	m_threadDetached = false;
 	Process::SetProcess( m_luaThread.InternalState(), this );
 }
 
-void csp::Process::SetParentProcess( Process& parentProcess )
+void csp::Process::DetachLuaThread()
+{
+	CORE_ASSERT( m_operation == NULL );
+	m_luaThread = lua::LuaState();
+	m_threadDetached = true;
+}
+
+void csp::Process::SetParentProcess( Process& parentProcess, ParentAttachment_i* pParentAttachment )
 {
 	m_parentProcess = &parentProcess;
+	m_pParentAttachment = pParentAttachment;
 }
 
 void csp::Process::SetIsOnStack( bool isOnStack )
@@ -181,3 +237,141 @@ bool csp::Process::IsOnStack() const
 {
 	return m_isOnStack;
 }
+
+void csp::Process::SetPreempted( bool preempted )
+{
+	m_preempted = preempted;
+}
+
+bool csp::Process::IsPreempted() const
+{
+	return m_preempted;
+}
+
+csp::ProcessLink& csp::Process::Link( ProcessLists::Enum list )
+{
+	return m_links[ list ];
+}
+
+const csp::ProcessLink& csp::Process::Link( ProcessLists::Enum list ) const
+{
+	return m_links[ list ];
+}
+
+
+csp::ProcessLink::ProcessLink()
+	: pPrev()
+	, pNext()
+{
+}
+
+
+csp::ProcessList::ProcessList( ProcessLists::Enum list )
+	: m_list( list )
+	, m_pHead()
+	, m_pTail()
+	, m_size( 0 )
+{
+}
+
+csp::ProcessList::~ProcessList()
+{
+	CORE_ASSERT( IsEmpty() );
+}
+
+void csp::ProcessList::PushFront( Process& process )
+{
+	CORE_ASSERT( !Contains( process ) );
+	ProcessLink& link = process.Link( m_list );
+
+	link.pPrev = NULL;
+	link.pNext = m_pHead;
+
+	if( m_pHead )
+		m_pHead->Link( m_list ).pPrev = &process;
+	else
+		m_pTail = &process;
+
+	m_pHead = &process;
+	++m_size;
+}
+
+void csp::ProcessList::PushBack( Process& process )
+{
+	CORE_ASSERT( !Contains( process ) );
+	ProcessLink& link = process.Link( m_list );
+
+	link.pPrev = m_pTail;
+	link.pNext = NULL;
+
+	if( m_pTail )
+		m_pTail->Link( m_list ).pNext = &process;
+	else
+		m_pHead = &process;
+
+	m_pTail = &process;
+	++m_size;
+}
+
+csp::Process& csp::ProcessList::PopFront()
+{
+	CORE_ASSERT( m_pHead );
+	Process& process = *m_pHead;
+	Remove( process );
+	return process;
+}
+
+void csp::ProcessList::Remove( Process& process )
+{
+	CORE_ASSERT( Contains( process ) );
+	ProcessLink& link = process.Link( m_list );
+
+	if( link.pPrev )
+		link.pPrev->Link( m_list ).pNext = link.pNext;
+	else
+		m_pHead = link.pNext;
+
+	if( link.pNext )
+		link.pNext->Link( m_list ).pPrev = link.pPrev;
+	else
+		m_pTail = link.pPrev;
+
+	link.pPrev = NULL;
+	link.pNext = NULL;
+	--m_size;
+}
+
+bool csp::ProcessList::Contains( const Process& process ) const
+{
+	return m_pHead == &process || process.Link( m_list ).pPrev != NULL;
+}
+
+bool csp::ProcessList::IsEmpty() const
+{
+	return m_pHead == NULL;
+}
+
+int csp::ProcessList::Size() const
+{
+	return m_size;
+}
+
+csp::Process* csp::ProcessList::Head() const
+{
+	return m_pHead;
+}
+
+csp::Process* csp::ProcessList::Tail() const
+{
+	return m_pTail;
+}
+
+csp::Process* csp::ProcessList::Next( const Process& process ) const
+{
+	return process.Link( m_list ).pNext;
+}
+
+csp::Process* csp::ProcessList::Prev( const Process& process ) const
+{
+	return process.Link( m_list ).pPrev;
+}
@@ -16,6 +16,54 @@ struct lua_State;
 namespace csp
 {
     class Operation;
+	class Process;
+
+	namespace ProcessLists
+	{
+		enum Enum
+		{
+			  WORK = 0
+			, EVAL
+			, PREEMPTED
+			, NUM_LISTS
+		};
+	}
+
+	struct ProcessLink
+	{
+		ProcessLink();
+
+		Process* pPrev;
+		Process* pNext;
+	};
+
+	// Intrusive doubly-linked list of processes. Each list kind uses its own link in Process.
+	class ProcessList
+	{
+	public:
+		explicit ProcessList( ProcessLists::Enum list );
+		~ProcessList();
+
+		void PushFront( Process& process );
+		void PushBack( Process& process );
+		Process& PopFront();
+		void Remove( Process& process );
+
+		bool Contains( const Process& process ) const;
+		bool IsEmpty() const;
+		int Size() const;
+
+		Process* Head() const;
+		Process* Tail() const;
+		Process* Next( const Process& process ) const;
+		Process* Prev( const Process& process ) const;
+
+	private:
+		ProcessLists::Enum m_list;
+		Process* m_pHead;
+		Process* m_pTail;
+		int m_size;
+	};
 
     class Process
     {
@@ -25,7 +73,9 @@ namespace csp
 
 		lua::LuaState & LuaThread();
 		void SetLuaThread( const lua::LuaState& luaThread );
-		void SetParentProcess( Process& parentProcess );
+		// The finished process gives its thread back to the coroutine pool and stays finished.
+		void DetachLuaThread();
+		void SetParentProcess( Process& parentProcess, ParentAttachment_i* pParentAttachment = NULL );
 
 		static Process* GetProcess( lua_State* luaState );
 		static void SetProcess( lua_State* luaState, Process* process );
@@ -38,7 +88,7 @@ namespace csp
 		void DoTerminate( Host& host );
 		void Terminate( Host& host );
 
-		void SwitchCurrentOperation( Operation* pOperation );
+		void SwitchCurrentOperation( Host& host, Operation* pOperation );
 		bool IsRunning() const;
 
 		bool IsInOperation() const;
@@ -47,13 +97,25 @@ namespace csp
 		void SetIsOnStack( bool isOnStack );
 		bool IsOnStack() const;
 
+		void SetPreempted( bool preempted );
+		bool IsPreempted() const;
+
+		ProcessLink& Link( ProcessLists::Enum list );
+		const ProcessLink& Link( ProcessLists::Enum list ) const;
+
     private:
-		WorkResult::Enum Resume( int numArgs );
+		WorkResult::Enum Resume( Host& host, int numArgs );
+		static void PreemptionHook( lua_State* luaState, lua_Debug* debug );
 		void DeleteOperation( Host& host );
 
 		lua::LuaState m_luaThread;
 		Process* m_parentProcess;
+		ParentAttachment_i* m_pParentAttachment;
         Operation* m_operation;
 		bool m_isOnStack;
+		bool m_preempted;
+		bool m_threadDetached;
+
+		ProcessLink m_links[ ProcessLists::NUM_LISTS ];
     };
 }
\ No newline at end of file
@@ -0,0 +1,227 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "selector.h"
+
+#include <luacpp/luastackvalue.h>
+
+#include "host.h"
+#include "channel.h"
+
+namespace csp
+{
+	int Selector_new( lua_State* luaState );
+	int Selector_SELECT( lua_State* luaState );
+
+	const csp::FunctionRegistration selectorGlobals[] =
+	{
+		"new", csp::Selector_new
+		, NULL, NULL
+	};
+
+	const csp::FunctionRegistration selectorFunctions[] =
+	{
+		"__gc", csp::GcObject_Gc
+		, "SELECT", csp::Selector_SELECT
+		, NULL, NULL
+	};
+}
+
+
+csp::Selector::Selector( int numCases )
+	: m_cases()
+	, m_numCases( numCases )
+	, m_selecting( false )
+{
+	if( m_numCases > 0 )
+		m_cases = CORE_NEW OpAlt::AltCase[ m_numCases ];
+}
+
+csp::Selector::~Selector()
+{
+	CORE_ASSERT( !m_selecting );
+
+	delete[] m_cases;
+	m_cases = NULL;
+	m_numCases = 0;
+}
+
+csp::OpAlt::AltCase* csp::Selector::Cases()
+{
+	return m_cases;
+}
+
+int csp::Selector::NumCases() const
+{
+	return m_numCases;
+}
+
+bool csp::Selector::IsSelecting() const
+{
+	return m_selecting;
+}
+
+void csp::Selector::SetSelecting( bool selecting )
+{
+	m_selecting = selecting;
+}
+
+
+csp::OpSelect::OpSelect()
+	: m_pSelector()
+	, m_selectorRefKey( lua::LUA_NO_REF )
+{
+}
+
+csp::OpSelect::~OpSelect()
+{
+	CORE_ASSERT( m_selectorRefKey == lua::LUA_NO_REF );
+
+	// the cases belong to the selector
+	m_cases = NULL;
+	m_numCases = 0;
+}
+
+bool csp::OpSelect::Init( lua::LuaStack& args, InitError& initError )
+{
+	lua::LuaStackValue selectorArg = args[1];
+	if( !IsSelectorArg( selectorArg ) )
+		return initError.ArgError( 1, "Selector object expected" );
+
+	Selector* pSelector = GetSelectorArg( selectorArg );
+	if( pSelector->IsSelecting() )
+		return initError.ArgError( 1, "the selector is selecting already" );
+
+	m_pSelector = pSelector;
+	m_pSelector->SetSelecting( true );
+
+	selectorArg.PushValue();
+	m_selectorRefKey = args.RefInRegistry();
+
+	m_cases = m_pSelector->Cases();
+	m_numCases = m_pSelector->NumCases();
+
+	// a guard closed meanwhile isn't attached and stays closed
+	for( int i = 0; i < m_numCases; ++i )
+	{
+		AltCase& altCase = m_cases[ i ];
+		if( altCase.m_pChannel && altCase.m_pChannel->IsClosed() && altCase.m_pChannel->IsBufferEmpty() )
+			altCase.m_pChannel = NULL;
+
+		if( altCase.m_pChannel )
+			InitChannelCase( altCase, *altCase.m_pChannel );
+	}
+
+	return true;
+}
+
+void csp::OpSelect::UnrefChannels( lua::LuaStack const& stack )
+{
+	// the guards are detached already: leave them armed for the next SELECT
+	if( m_pSelector )
+	{
+		m_pSelector->SetSelecting( false );
+		m_pSelector = NULL;
+	}
+
+	m_cases = NULL;
+	m_numCases = 0;
+
+	stack.UnrefInRegistry( m_selectorRefKey );
+	m_selectorRefKey = lua::LUA_NO_REF;
+}
+
+void csp::OpSelect::PushGuards( lua::LuaStack& stack ) const
+{
+	stack.PushRegistryReferenced( m_selectorRefKey );
+	stack.GetTopValue().PushUserValue();
+	stack.Remove( stack.GetTop() - 1 );
+}
+
+int csp::OpSelect::PushCaseClosure( lua::LuaStack& stack, AltCase& altCase )
+{
+	PushGuards( stack );
+	stack.GetTopValue().PushRawGetIndex( (int)( &altCase - m_cases )*2 + 2 );
+	stack.Remove( stack.GetTop() - 1 );
+	return 0;
+}
+
+void csp::OpSelect::PushCaseChannel( lua::LuaStack& stack, AltCase& altCase )
+{
+	PushGuards( stack );
+	stack.GetTopValue().PushRawGetIndex( (int)( &altCase - m_cases )*2 + 1 );
+	stack.Remove( stack.GetTop() - 1 );
+}
+
+
+csp::Selector& csp::PushSelector( lua_State* luaState, int numCases )
+{
+	return *new( PushGcObjectMemory( luaState, sizeof( Selector ), selectorFunctions ) ) Selector( numCases );
+}
+
+bool csp::IsSelectorArg( lua::LuaStackValue const& value )
+{
+	return IsGcObject( value, selectorFunctions );
+}
+
+csp::Selector* csp::GetSelectorArg( lua::LuaStackValue const& value )
+{
+	return static_cast< Selector* >( GetGcObject( value, selectorFunctions ) );
+}
+
+int csp::Selector_new( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	// called as Selector:new( ch1, f1, ch2, f2, ... )
+	int numArgs = args.NumArgs() - 1;
+	if( (numArgs & 1) != 0 )
+		return args.Error( "even number of arguments required. (channel+closure) pairs required" );
+
+	for( int i = 2; i <= args.NumArgs(); i += 2 )
+	{
+		lua::LuaStackValue guard = args[i];
+		if( !IsChannelArg( guard ) || GetChannelArg( guard ) == NULL )
+			return guard.ArgError( "channel required as a guard" );
+
+		if( !args[i+1].IsFunction() )
+			return args[i+1].ArgError( "closure required" );
+	}
+
+	int numCases = numArgs/2;
+	csp::Selector& newSelector = csp::PushSelector( luaState, numCases );
+	lua::LuaStackValue selector = args.GetTopValue();
+
+	OpAlt::AltCase* cases = newSelector.Cases();
+	for( int i = 0; i < numCases; ++i )
+		cases[ i ].m_pChannel = GetChannelArg( args[ 2 + i*2 ] );
+
+	lua::LuaStackValue guards = args.PushTable( numArgs );
+	for( int i = 1; i <= numArgs; ++i )
+	{
+		args[ 1 + i ].PushValue();
+		guards.RawSetIndex( i );
+	}
+	selector.SetUserValue();
+
+	return 1;
+}
+
+int csp::Selector_SELECT( lua_State* luaState )
+{
+	OpSelect* pSelect = new( Host::GetHost( luaState ) ) OpSelect();
+	return pSelect->DoInit( luaState );
+}
+
+void csp::InitializeSelectors( lua::LuaState& state )
+{
+	InitializeCspObject( state, "Selector", selectorGlobals, selectorFunctions );
+}
+
+void csp::ShutdownSelectors( lua::LuaState& state )
+{
+	ShutdownCspObject( state, "Selector", selectorGlobals, selectorFunctions );
+}
@@ -0,0 +1,68 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include "csp.h"
+
+#include "op_alt.h"
+
+namespace lua
+{
+	class LuaState;
+}
+
+namespace csp
+{
+	// Channel guards of a SELECT loop, set up once by Selector:new( ch1, f1, ch2, f2, ... ).
+	// The guards and closures are kept by the selector uservalue table, not by registry refs.
+	// Between SELECT calls the guards aren't queued on their channels: writers must not hand
+	// values to a selector which doesn't read. Re-arming a guard only links its waiter back.
+	class Selector : public GcObject
+	{
+	public:
+		explicit Selector( int numCases );
+		virtual ~Selector();
+
+		OpAlt::AltCase* Cases();
+		int NumCases() const;
+
+		bool IsSelecting() const;
+		void SetSelecting( bool selecting );
+
+	private:
+		OpAlt::AltCase* m_cases;
+		int m_numCases;
+		bool m_selecting;
+	};
+
+	class OpSelect : public OpAlt
+	{
+	public:
+		OpSelect();
+		virtual ~OpSelect();
+
+	private:
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+
+		virtual void UnrefChannels( lua::LuaStack const& stack );
+
+		virtual int PushCaseClosure( lua::LuaStack& stack, AltCase& altCase );
+		virtual void PushCaseChannel( lua::LuaStack& stack, AltCase& altCase );
+		void PushGuards( lua::LuaStack& stack ) const;
+
+		Selector* m_pSelector;
+		lua::LuaRef_t m_selectorRefKey;
+	};
+
+	Selector& PushSelector( lua_State* luaState, int numCases );
+	bool IsSelectorArg( lua::LuaStackValue const& value );
+	Selector* GetSelectorArg( lua::LuaStackValue const& value );
+
+	void InitializeSelectors( lua::LuaState& state );
+	void ShutdownSelectors( lua::LuaState& state );
+}
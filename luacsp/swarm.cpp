@@ -34,8 +34,10 @@ namespace csp
 }
 
 
-csp::Swarm::Swarm()
+csp::Swarm::Swarm( int maxConcurrent, int highWater )
 	: m_pOpMain()
+	, m_maxConcurrent( maxConcurrent )
+	, m_highWater( highWater )
 {
 }
 
@@ -50,6 +52,11 @@ int csp::Swarm::DoGo( lua::LuaStack& args )
 	return m_pOpMain->Go( args );
 }
 
+csp::OpSwarmMain* csp::Swarm::OpMain() const
+{
+	return m_pOpMain;
+}
+
 void csp::Swarm::InitMain( OpSwarmMain& opMain )
 {
 	m_pOpMain = &opMain;
@@ -60,11 +67,24 @@ void csp::Swarm::Terminate()
 	m_pOpMain = NULL;
 }
 
+int csp::Swarm::MaxConcurrent() const
+{
+	return m_maxConcurrent;
+}
+
+int csp::Swarm::HighWater() const
+{
+	return m_highWater;
+}
+
 
 csp::OpSwarmMain::OpSwarmMain()
 	: m_pSwarm()
 	, m_pClosuresHead(), m_pClosuresTail()
 	, m_pClosuresToRunHead(), m_pClosuresToRunTail()
+	, m_numRunning( 0 )
+	, m_numToRun( 0 )
+	, m_pGoWaitersHead(), m_pGoWaitersTail()
 {
 }
 
@@ -81,81 +101,138 @@ void csp::OpSwarmMain::DeleteClosures( SwarmClosure*& pHead, SwarmClosure*& pTai
 	while( pHead )
 	{
 		SwarmClosure* pNext = pHead->pNext;
-		delete pHead;
+		pHead->~SwarmClosure();
+		BlockAllocator::Free( pHead );
 		pHead = pNext;
 	}
 
 	pTail = NULL;
 }
 
-void csp::OpSwarmMain::UnrefClosures( SwarmClosure* pHead )
+void csp::OpSwarmMain::UnrefClosures( Host& host, SwarmClosure* pHead )
 {
 	for( SwarmClosure* pClosure = pHead; pClosure; pClosure = pClosure->pNext )
 	{
-		if( pClosure->refKey != lua::LUA_NO_REF )
-		{
-			ThisProcess().LuaThread().GetStack().UnrefInRegistry( pClosure->refKey );
-			pClosure->refKey = lua::LUA_NO_REF;
-		}
+		host.Coroutines().Release( pClosure->process, pClosure->refKey );
+		host.LuaState().GetStack().UnrefInRegistry( pClosure->closureRefKey );
+		pClosure->closureRefKey = lua::LUA_NO_REF;
 	}
 }
 
 void csp::OpSwarmMain::Terminate( Host& host )
 {
+	// terminated processes don't finish, they stay in the list
 	for( SwarmClosure* pClosure = m_pClosuresHead; pClosure; pClosure = pClosure->pNext )
 		pClosure->process.Terminate( host );
 
-	UnrefClosures( m_pClosuresHead );
-	UnrefClosures( m_pClosuresToRunHead );
+	UnrefClosures( host, m_pClosuresHead );
+	UnrefClosures( host, m_pClosuresToRunHead );
+
+	// the backlog is dropped, so go returns
+	while( m_pGoWaitersHead )
+	{
+		OpSwarmGo& opGo = *m_pGoWaitersHead;
+		DetachGoWaiter( opGo );
+		opGo.Wake( host );
+	}
 
 	CORE_ASSERT( m_pSwarm );
 	m_pSwarm->Terminate();
 	m_pSwarm = NULL;
 }
 
-csp::WorkResult::Enum csp::OpSwarmMain::Work( Host& host, CspTime_t dt )
+csp::WorkResult::Enum csp::OpSwarmMain::Work( Host&, CspTime_t )
 {
-	for( SwarmClosure* pClosure = m_pClosuresHead; pClosure; pClosure = pClosure->pNext )
-	{
-		if( pClosure->process.IsRunning() )
-			pClosure->process.Work( host, dt );
-	}
 	return WorkResult::YIELD; // never ends.
 }
 
-void csp::OpSwarmMain::CheckFinished()
+bool csp::OpSwarmMain::RequiresWork() const
+{
+	// sub-processes are updated by the host directly
+	return false;
+}
+
+void csp::OpSwarmMain::ClosureFinished( Host& host, SwarmClosure& closure )
+{
+	ListRemove( m_pClosuresHead, m_pClosuresTail, closure );
+	--m_numRunning;
+	host.Coroutines().Release( closure.process, closure.refKey );
+
+	closure.~SwarmClosure();
+	BlockAllocator::Free( &closure );
+
+	// admits the next one
+	if( m_pClosuresToRunHead && !ThisProcess().IsOnStack() )
+		host.PushEvalStep( ThisProcess() );
+}
+
+bool csp::OpSwarmMain::CanAdmit() const
+{
+	int maxConcurrent = m_pSwarm->MaxConcurrent();
+	return maxConcurrent == 0 || m_numRunning < maxConcurrent;
+}
+
+bool csp::OpSwarmMain::IsOverHighWater() const
+{
+	int highWater = m_pSwarm->HighWater();
+	return highWater > 0 && m_numToRun > highWater;
+}
+
+void csp::OpSwarmMain::AttachGoWaiter( OpSwarmGo& opGo )
+{
+	if( m_pGoWaitersTail )
+		m_pGoWaitersTail->m_pNext = &opGo;
+	else
+		m_pGoWaitersHead = &opGo;
+
+	opGo.m_pPrev = m_pGoWaitersTail;
+	opGo.m_pNext = NULL;
+	opGo.m_pOpMain = this;
+	m_pGoWaitersTail = &opGo;
+}
+
+void csp::OpSwarmMain::DetachGoWaiter( OpSwarmGo& opGo )
 {
-	for( SwarmClosure* pClosure = m_pClosuresHead, *pPrev = NULL; pClosure; )
+	if( opGo.m_pPrev )
+		opGo.m_pPrev->m_pNext = opGo.m_pNext;
+	else
+		m_pGoWaitersHead = opGo.m_pNext;
+
+	if( opGo.m_pNext )
+		opGo.m_pNext->m_pPrev = opGo.m_pPrev;
+	else
+		m_pGoWaitersTail = opGo.m_pPrev;
+
+	opGo.m_pPrev = NULL;
+	opGo.m_pNext = NULL;
+	opGo.m_pOpMain = NULL;
+}
+
+void csp::OpSwarmMain::WakeGoWaiters( Host& host )
+{
+	while( m_pGoWaitersHead && !IsOverHighWater() )
 	{
-		SwarmClosure* pNext = pClosure->pNext;
-
-		if( !pClosure->process.IsRunning() && pClosure->refKey != lua::LUA_NO_REF )
-		{
-			ThisProcess().LuaThread().GetStack().UnrefInRegistry( pClosure->refKey );
-			pClosure->refKey = lua::LUA_NO_REF;
-
-			if( pClosure == m_pClosuresHead )
-			{
-				m_pClosuresHead = pNext;
-			}
-			else
-			{
-				CORE_ASSERT( pPrev );
-				pPrev->pNext = pNext;
-			}
-
-			if( pClosure == m_pClosuresTail )
-				m_pClosuresTail = pPrev;
-
-			delete pClosure;
-		}
-		else
-			pPrev = pClosure;
-
-		pClosure = pNext;
+		OpSwarmGo& opGo = *m_pGoWaitersHead;
+		DetachGoWaiter( opGo );
+		opGo.Wake( host );
 	}
 }
 
+csp::OpSwarmMain::SwarmClosure::SwarmClosure( OpSwarmMain& opMain )
+	: opMain( opMain )
+	, pPrev()
+	, pNext()
+	, process()
+	, refKey( lua::LUA_NO_REF )
+	, closureRefKey( lua::LUA_NO_REF )
+{
+}
+
+void csp::OpSwarmMain::SwarmClosure::ChildFinished( Host& host, Process& )
+{
+	opMain.ClosureFinished( host, *this );
+}
+
 int csp::OpSwarmMain::Go( lua::LuaStack& args )
 {
 	for( int i = 2; i <= args.NumArgs(); ++i )
@@ -165,25 +242,24 @@ int csp::OpSwarmMain::Go( lua::LuaStack& args )
 			return args.ArgError( i, "function closure expected" );
 	}
 
+	Host& host = Host::GetHost( args.InternalState() );
+
 	for( int i = 2; i <= args.NumArgs(); ++i )
 	{
 		lua::LuaStackValue arg = args[i];
-		SwarmClosure* pClosure = CORE_NEW SwarmClosure();
+		SwarmClosure* pClosure = new( host.Allocator().Allocate( sizeof( SwarmClosure ) ) ) SwarmClosure( *this );
 
-		lua::LuaState thread = args.NewThread();
+		// a closure in the backlog keeps its function only, the thread is acquired on admission
 		arg.PushValue();
-		args.XMove( thread.GetStack(), 1 );
+		pClosure->closureRefKey = args.RefInRegistry();
 
-		pClosure->process.SetLuaThread( thread );
-		pClosure->process.SetParentProcess( ThisProcess() );
-		pClosure->refKey = args.RefInRegistry();
+		pClosure->process.SetParentProcess( ThisProcess(), pClosure );
 
 		ListAddToTail( m_pClosuresToRunHead, m_pClosuresToRunTail, *pClosure );
+		++m_numToRun;
 	}
 
-	Host& host = Host::GetHost( args.InternalState() );
-	
-	if( !ThisProcess().IsOnStack() )
+	if( CanAdmit() && !ThisProcess().IsOnStack() )
 		host.PushEvalStep( ThisProcess() );
 
 	return 0;
@@ -191,20 +267,30 @@ int csp::OpSwarmMain::Go( lua::LuaStack& args )
 
 csp::WorkResult::Enum csp::OpSwarmMain::Evaluate( Host& host )
 {
-	if( m_pClosuresToRunHead )
+	if( m_pClosuresToRunHead && CanAdmit() )
 	{		
 		SwarmClosure* pClosure = ListPopFromHead( m_pClosuresToRunHead, m_pClosuresToRunTail );
 		CORE_ASSERT( pClosure );
+		--m_numToRun;
+
+		lua::LuaState thread = host.Coroutines().Acquire( pClosure->process, pClosure->refKey );
+		lua::LuaStack& threadStack = thread.GetStack();
+		threadStack.PushRegistryReferenced( pClosure->closureRefKey );
+		threadStack.UnrefInRegistry( pClosure->closureRefKey );
+		pClosure->closureRefKey = lua::LUA_NO_REF;
 
 		ListAddToTail( m_pClosuresHead, m_pClosuresTail, *pClosure );
+		++m_numRunning;
 
-		if( m_pClosuresToRunHead )
+		if( m_pClosuresToRunHead && CanAdmit() )
 			host.PushEvalStep( ThisProcess() );
 
+		WakeGoWaiters( host );
+
+		// the closure is deleted right away if it finishes
 		pClosure->process.StartEvaluation( host, 0 );
 	}
 
-	CheckFinished();
 	return WorkResult::YIELD;
 }
 
@@ -215,7 +301,24 @@ void csp::OpSwarmMain::ListAddToTail( SwarmClosure*& pHead, SwarmClosure*& pTail
 	if( pHead == NULL )
 		pHead = &node;
 	
+	node.pPrev = pTail;
+	node.pNext = NULL;
 	pTail = &node;
+}
+
+void csp::OpSwarmMain::ListRemove( SwarmClosure*& pHead, SwarmClosure*& pTail, SwarmClosure& node )
+{
+	if( node.pPrev )
+		node.pPrev->pNext = node.pNext;
+	else
+		pHead = node.pNext;
+
+	if( node.pNext )
+		node.pNext->pPrev = node.pPrev;
+	else
+		pTail = node.pPrev;
+
+	node.pPrev = NULL;
 	node.pNext = NULL;
 }
 
@@ -225,11 +328,7 @@ csp::OpSwarmMain::SwarmClosure* csp::OpSwarmMain::ListPopFromHead( SwarmClosure*
 		return NULL;
 
 	SwarmClosure* pNode = pHead;
-	pHead = pHead->pNext;
-	if( pNode == pTail )
-		pTail = NULL;
-
-	pNode->pNext = NULL;
+	ListRemove( pHead, pTail, *pNode );
 	return pNode;
 }
 
@@ -271,36 +370,96 @@ void csp::OpSwarmMain::DebugCheckList( Host& host, SwarmClosure* pHead ) const
 }
 
 
-void csp::PushSwarm( lua_State* luaState, Swarm& swarm )
+csp::OpSwarmGo::OpSwarmGo()
+	: m_pOpMain()
+	, m_pPrev()
+	, m_pNext()
+	, m_woken( false )
 {
-	PushGcObject( luaState, swarm, swarmFunctions );
+}
+
+csp::OpSwarmGo::~OpSwarmGo()
+{
+	CORE_ASSERT( m_pOpMain == NULL );
+}
+
+bool csp::OpSwarmGo::Init( lua::LuaStack& args, InitError& )
+{
+	Swarm* pSwarm = GetSwarmArg( args[1] );
+	CORE_ASSERT( pSwarm && pSwarm->OpMain() );
+
+	pSwarm->OpMain()->AttachGoWaiter( *this );
+	return true;
+}
+
+void csp::OpSwarmGo::Wake( Host& host )
+{
+	m_woken = true;
+	host.PushEvalStep( ThisProcess() );
+}
+
+csp::WorkResult::Enum csp::OpSwarmGo::Evaluate( Host& )
+{
+	return m_woken ? WorkResult::FINISH : WorkResult::YIELD;
+}
+
+csp::WorkResult::Enum csp::OpSwarmGo::Work( Host&, CspTime_t )
+{
+	return WorkResult::YIELD;
+}
+
+void csp::OpSwarmGo::Terminate( Host& )
+{
+	if( m_pOpMain )
+		m_pOpMain->DetachGoWaiter( *this );
+}
+
+
+csp::Swarm& csp::PushSwarm( lua_State* luaState, int maxConcurrent, int highWater )
+{
+	return *new( PushGcObjectMemory( luaState, sizeof( Swarm ), swarmFunctions ) ) Swarm( maxConcurrent, highWater );
 }
 
 bool csp::IsSwarmArg( lua::LuaStackValue const& value )
 {
-	return value.IsUserData(); // TODO: add more checks.
+	return IsGcObject( value, swarmFunctions );
 }
 
 csp::Swarm* csp::GetSwarmArg( lua::LuaStackValue const& value )
 {
-	if( !value.IsUserData() )
-		return NULL;
-
-	GcObject** pGcObject = (GcObject**)value.GetUserData();
-	Swarm* pSwarm = static_cast< Swarm* >( *pGcObject ); // TODO: add more type checks.
-	return pSwarm;
+	return static_cast< Swarm* >( GetGcObject( value, swarmFunctions ) );
 }
 
 int csp::Swarm_new( lua_State* luaState )
 {
-	csp::Swarm* pSwarm = CORE_NEW csp::Swarm();
-	csp::PushSwarm( luaState, *pSwarm );
+	lua::LuaStack args( luaState );
+	// called as Swarm:new() or Swarm:new{ maxConcurrent = N, highWater = M }
+	int maxConcurrent = 0;
+	int highWater = 0;
+
+	lua::LuaStackValue options = args[2];
+	if( args.NumArgs() >= 2 && !options.IsNil() )
+	{
+		if( !options.IsTable() )
+			return options.ArgError( "options table expected" );
+
+		maxConcurrent = args.GetField( options, "maxConcurrent" ).OptInteger( 0 );
+		highWater = args.GetField( options, "highWater" ).OptInteger( 0 );
+		args.Pop( 2 );
+
+		if( maxConcurrent < 0 )
+			return options.ArgError( "non-negative maxConcurrent expected" );
+		if( highWater < 0 )
+			return options.ArgError( "non-negative highWater expected" );
+	}
+
+	csp::PushSwarm( luaState, maxConcurrent, highWater );
 	return 1;
 }
 
 int csp::Swarm_MAIN( lua_State* luaState )
 {
-	OpSwarmMain* pMain = CORE_NEW OpSwarmMain();
+	OpSwarmMain* pMain = new( Host::GetHost( luaState ) ) OpSwarmMain();
 	return pMain->DoInit( luaState );
 }
 
@@ -315,7 +474,12 @@ int csp::Swarm_go( lua_State* luaState )
 	if( pSwarm == NULL )
 		return swarmArg.ArgError( "Swarm pointer expected" );
 
-	return pSwarm->DoGo( args );
+	int numResults = pSwarm->DoGo( args );
+	if( !pSwarm->OpMain()->IsOverHighWater() )
+		return numResults;
+
+	OpSwarmGo* pGo = new( Host::GetHost( luaState ) ) OpSwarmGo();
+	return pGo->DoInit( luaState );
 }
 
 void csp::InitializeSwarms( lua::LuaState& state )
@@ -20,23 +20,32 @@ namespace csp
 {
 	class Swarm;
 	class OpSwarmMain;
+	class OpSwarmGo;
 }
 
 namespace csp
 {
+	// Swarm:new{ maxConcurrent = N, highWater = M }: at most N closures run at once, the rest wait
+	// in the backlog. go blocks while more than M closures wait. Zero means no limit.
 	class Swarm : public GcObject
 	{
 	public:
-		Swarm();
+		Swarm( int maxConcurrent, int highWater );
 		virtual ~Swarm();
 
 		int DoGo( lua::LuaStack& args );
+		OpSwarmMain* OpMain() const;
 		
 		void InitMain( OpSwarmMain& opMain );
 		void Terminate();
+
+		int MaxConcurrent() const;
+		int HighWater() const;
 	
 	private:
 		OpSwarmMain* m_pOpMain;
+		int m_maxConcurrent;
+		int m_highWater;
 	};
 
 	class OpSwarmMain : public Operation
@@ -47,38 +56,84 @@ namespace csp
 
 		int Go( lua::LuaStack& args );
 
+		bool IsOverHighWater() const;
+		void AttachGoWaiter( OpSwarmGo& opGo );
+		void DetachGoWaiter( OpSwarmGo& opGo );
+
 	private:
 		struct SwarmClosure;
 
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 		virtual void Terminate( Host& host );
 		virtual void DebugCheck( Host& host ) const;
 		
 		void DebugCheckList( Host& host, SwarmClosure* pHead ) const;
-		void CheckFinished();
+		void ClosureFinished( Host& host, SwarmClosure& closure );
+		bool CanAdmit() const;
+		void WakeGoWaiters( Host& host );
 
 		Swarm* m_pSwarm;
 
-		struct SwarmClosure
+		// Closures are carved from the host allocator slabs, so spawning reuses the blocks of finished ones.
+		// Each closure is the parent attachment of its process: a finished process unlinks itself in O(1).
+		struct SwarmClosure : ParentAttachment_i
 		{
+			explicit SwarmClosure( OpSwarmMain& opMain );
+			virtual void ChildFinished( Host& host, Process& process );
+
+			OpSwarmMain& opMain;
+			SwarmClosure* pPrev;
 			SwarmClosure* pNext;
 			Process process;
 			lua::LuaRef_t refKey;
+			lua::LuaRef_t closureRefKey;
+
+		private:
+			SwarmClosure& operator=( const SwarmClosure& );
 		};
 
-		void UnrefClosures( SwarmClosure* pHead );
+		void UnrefClosures( Host& host, SwarmClosure* pHead );
 		static void DeleteClosures( SwarmClosure*& pHead, SwarmClosure*& pTail );
 
 		static SwarmClosure* ListPopFromHead( SwarmClosure*& pHead, SwarmClosure*& pTail );
 		static void ListAddToTail( SwarmClosure*& pHead, SwarmClosure*& pTail, SwarmClosure& node );
+		static void ListRemove( SwarmClosure*& pHead, SwarmClosure*& pTail, SwarmClosure& node );
 
 		SwarmClosure *m_pClosuresHead, *m_pClosuresTail;
 		SwarmClosure *m_pClosuresToRunHead, *m_pClosuresToRunTail;
+		int m_numRunning;
+		int m_numToRun;
+
+		OpSwarmGo *m_pGoWaitersHead, *m_pGoWaitersTail;
+	};
+
+	// go over the high-water mark: the closures are queued, the caller waits for the backlog to drain.
+	class OpSwarmGo : public Operation
+	{
+	public:
+		OpSwarmGo();
+		virtual ~OpSwarmGo();
+
+		void Wake( Host& host );
+
+	private:
+		friend class OpSwarmMain;
+
+		virtual bool Init( lua::LuaStack& args, InitError& initError );
+		virtual WorkResult::Enum Evaluate( Host& host );
+		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual void Terminate( Host& host );
+
+		OpSwarmMain* m_pOpMain;
+		OpSwarmGo* m_pPrev;
+		OpSwarmGo* m_pNext;
+		bool m_woken;
 	};
 
-	void PushSwarm( lua_State* luaState, Swarm& swarm );
+	Swarm& PushSwarm( lua_State* luaState, int maxConcurrent = 0, int highWater = 0 );
 	bool IsSwarmArg( lua::LuaStackValue const& value );
 	Swarm* GetSwarmArg( lua::LuaStackValue const& value );
 
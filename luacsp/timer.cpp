@@ -0,0 +1,225 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "timer.h"
+
+#include "host.h"
+
+namespace csp
+{
+	static const int TIMER_HEAP_INITIAL_CAPACITY = 64;
+	static const int TIMER_NOT_SCHEDULED = -1;
+}
+
+csp::Timer::Timer()
+	: m_pAttachment()
+	, m_pNextExpired()
+	, m_deadline( 0 )
+	, m_order( 0 )
+	, m_heapIndex( TIMER_NOT_SCHEDULED )
+{
+}
+
+csp::Timer::~Timer()
+{
+	CORE_ASSERT( !IsScheduled() );
+}
+
+void csp::Timer::SetAttachment( TimerAttachment_i& attachment )
+{
+	m_pAttachment = &attachment;
+}
+
+bool csp::Timer::IsScheduled() const
+{
+	return m_heapIndex != TIMER_NOT_SCHEDULED;
+}
+
+csp::CspTime_t csp::Timer::Deadline() const
+{
+	return m_deadline;
+}
+
+
+csp::TimerQueue::TimerQueue()
+	: m_heap()
+	, m_numTimers( 0 )
+	, m_capacity( 0 )
+	, m_order( 0 )
+{
+}
+
+csp::TimerQueue::~TimerQueue()
+{
+	CORE_ASSERT( m_numTimers == 0 );
+
+	delete[] m_heap;
+	m_heap = NULL;
+}
+
+void csp::TimerQueue::Schedule( Timer& timer, CspTime_t deadline )
+{
+	CORE_ASSERT( timer.m_pAttachment );
+	CORE_ASSERT( !timer.IsScheduled() );
+
+	if( m_numTimers == m_capacity )
+		Grow();
+
+	timer.m_deadline = deadline;
+	timer.m_order = m_order++;
+
+	Place( timer, m_numTimers++ );
+	SiftUp( timer.m_heapIndex );
+}
+
+void csp::TimerQueue::Cancel( Timer& timer )
+{
+	if( !timer.IsScheduled() )
+		return;
+
+	int index = timer.m_heapIndex;
+	CORE_ASSERT( index < m_numTimers && m_heap[ index ] == &timer );
+
+	timer.m_heapIndex = TIMER_NOT_SCHEDULED;
+
+	--m_numTimers;
+	if( index == m_numTimers )
+	{
+		m_heap[ index ] = NULL;
+		return;
+	}
+
+	Timer& moved = *m_heap[ m_numTimers ];
+	m_heap[ m_numTimers ] = NULL;
+	Place( moved, index );
+
+	SiftUp( moved.m_heapIndex );
+	SiftDown( moved.m_heapIndex );
+}
+
+bool csp::TimerQueue::IsEmpty() const
+{
+	return m_numTimers == 0;
+}
+
+int csp::TimerQueue::NumTimers() const
+{
+	return m_numTimers;
+}
+
+csp::CspTime_t csp::TimerQueue::NextDeadline() const
+{
+	CORE_ASSERT( !IsEmpty() );
+	return m_heap[ 0 ]->m_deadline;
+}
+
+void csp::TimerQueue::Expire( Host& host, CspTime_t time )
+{
+	Timer* pExpired = NULL;
+	Timer* pLastExpired = NULL;
+	bool lifo = host.GetEvalOrder() == EvalOrder::LIFO;
+
+	// Pop in deadline order. For LIFO evaluation the list is fired in reverse, so the earliest
+	// timer is pushed onto the evaluation stack last and gets evaluated first.
+	while( m_numTimers > 0 && m_heap[ 0 ]->m_deadline <= time )
+	{
+		Timer& timer = *m_heap[ 0 ];
+		Cancel( timer );
+
+		if( lifo )
+		{
+			timer.m_pNextExpired = pExpired;
+			pExpired = &timer;
+		}
+		else
+		{
+			if( pLastExpired )
+				pLastExpired->m_pNextExpired = &timer;
+			else
+				pExpired = &timer;
+			pLastExpired = &timer;
+		}
+	}
+
+	while( pExpired )
+	{
+		Timer& timer = *pExpired;
+		pExpired = timer.m_pNextExpired;
+		timer.m_pNextExpired = NULL;
+
+		timer.m_pAttachment->ExpireTimer( host );
+	}
+}
+
+bool csp::TimerQueue::Less( const Timer& left, const Timer& right ) const
+{
+	if( left.m_deadline != right.m_deadline )
+		return left.m_deadline < right.m_deadline;
+
+	return left.m_order < right.m_order;
+}
+
+void csp::TimerQueue::Place( Timer& timer, int index )
+{
+	m_heap[ index ] = &timer;
+	timer.m_heapIndex = index;
+}
+
+void csp::TimerQueue::SiftUp( int index )
+{
+	Timer& timer = *m_heap[ index ];
+
+	while( index > 0 )
+	{
+		int parent = ( index - 1 ) / 2;
+		if( !Less( timer, *m_heap[ parent ] ) )
+			break;
+
+		Place( *m_heap[ parent ], index );
+		index = parent;
+	}
+
+	Place( timer, index );
+}
+
+void csp::TimerQueue::SiftDown( int index )
+{
+	Timer& timer = *m_heap[ index ];
+
+	for(;;)
+	{
+		int child = index * 2 + 1;
+		if( child >= m_numTimers )
+			break;
+
+		if( child + 1 < m_numTimers && Less( *m_heap[ child + 1 ], *m_heap[ child ] ) )
+			++child;
+
+		if( !Less( *m_heap[ child ], timer ) )
+			break;
+
+		Place( *m_heap[ child ], index );
+		index = child;
+	}
+
+	Place( timer, index );
+}
+
+void csp::TimerQueue::Grow()
+{
+	int capacity = m_capacity > 0 ? m_capacity * 2 : TIMER_HEAP_INITIAL_CAPACITY;
+	Timer** heap = CORE_NEW Timer*[ capacity ];
+
+	for( int i = 0; i < m_numTimers; ++i )
+		heap[ i ] = m_heap[ i ];
+	for( int i = m_numTimers; i < capacity; ++i )
+		heap[ i ] = NULL;
+
+	delete[] m_heap;
+	m_heap = heap;
+	m_capacity = capacity;
+}
@@ -0,0 +1,68 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include "csp.h"
+
+namespace csp
+{
+	class TimerQueue;
+
+	class Timer
+	{
+	public:
+		Timer();
+		~Timer();
+
+		void SetAttachment( TimerAttachment_i& attachment );
+
+		bool IsScheduled() const;
+		CspTime_t Deadline() const;
+
+	private:
+		friend class TimerQueue;
+
+		TimerAttachment_i* m_pAttachment;
+		Timer* m_pNextExpired;
+
+		CspTime_t m_deadline;
+		unsigned int m_order;
+		int m_heapIndex;
+	};
+
+	// Binary min-heap of absolute deadlines. Timers are intrusive: scheduling and cancellation are O(log n),
+	// a tick costs O(1) if nothing expires.
+	class TimerQueue
+	{
+	public:
+		TimerQueue();
+		~TimerQueue();
+
+		void Schedule( Timer& timer, CspTime_t deadline );
+		void Cancel( Timer& timer );
+
+		bool IsEmpty() const;
+		int NumTimers() const;
+		CspTime_t NextDeadline() const;
+
+		void Expire( Host& host, CspTime_t time );
+
+	private:
+		bool Less( const Timer& left, const Timer& right ) const;
+		void Place( Timer& timer, int index );
+		void SiftUp( int index );
+		void SiftDown( int index );
+		void Grow();
+
+		Timer** m_heap;
+		int m_numTimers;
+		int m_capacity;
+
+		unsigned int m_order;
+	};
+}
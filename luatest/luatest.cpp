@@ -85,19 +85,15 @@ void csp::OpTestSuite_RunAll::DeleteClosures( TestClosure*& pHead, TestClosure*&
 	pTail = NULL;
 }
 
-void csp::OpTestSuite_RunAll::UnrefClosure( TestClosure* pClosure )
+void csp::OpTestSuite_RunAll::UnrefClosure( Host& host, TestClosure* pClosure )
 {
-	if( pClosure->refKey != lua::LUA_NO_REF )
-	{
-		ThisProcess().LuaThread().GetStack().UnrefInRegistry( pClosure->refKey );
-		pClosure->refKey = lua::LUA_NO_REF;
-	}
+	host.Coroutines().Release( pClosure->process, pClosure->refKey );
 }
 
-void csp::OpTestSuite_RunAll::UnrefClosures( TestClosure* pHead )
+void csp::OpTestSuite_RunAll::UnrefClosures( Host& host, TestClosure* pHead )
 {
 	for( TestClosure* pClosure = pHead; pClosure; pClosure = pClosure->pNext )
-		UnrefClosure( pClosure );
+		UnrefClosure( host, pClosure );
 }
 
 void csp::OpTestSuite_RunAll::Terminate( Host& host )
@@ -105,22 +101,21 @@ void csp::OpTestSuite_RunAll::Terminate( Host& host )
 	if( m_pCurrentClosure )
 		m_pCurrentClosure->process.Terminate( host );
 
-	UnrefClosures( m_pClosuresHead );
+	UnrefClosures( host, m_pClosuresHead );
 	if( m_pCurrentClosure )
-		UnrefClosure( m_pCurrentClosure );
+		UnrefClosure( host, m_pCurrentClosure );
 }
 
-csp::WorkResult::Enum csp::OpTestSuite_RunAll::Work( Host& host, CspTime_t dt )
+csp::WorkResult::Enum csp::OpTestSuite_RunAll::Work( Host&, CspTime_t )
 {
-	if( m_pCurrentClosure )
-	{
-		if( m_pCurrentClosure->process.IsRunning() )
-			m_pCurrentClosure->process.Work( host, dt );
-	}
-
 	return IsFinished();
 }
 
+bool csp::OpTestSuite_RunAll::RequiresWork() const
+{
+	return false;
+}
+
 csp::WorkResult::Enum csp::OpTestSuite_RunAll::Evaluate( Host& host )
 {
 	if( m_pCurrentClosure )
@@ -130,7 +125,7 @@ csp::WorkResult::Enum csp::OpTestSuite_RunAll::Evaluate( Host& host )
 		else
 		{
 			if( m_pCurrentClosure->refKey != lua::LUA_NO_REF )
-				UnrefClosure( m_pCurrentClosure );
+				UnrefClosure( host, m_pCurrentClosure );
 
 			if( m_pCurrentClosure->numChecksFailed > 0 )
 				lua::Print( "FAILED!\n" );
@@ -249,14 +244,14 @@ void csp::OpTestSuite_RunAll::InitTestSuiteEnv( lua::LuaStack& stack, const char
 void csp::OpTestSuite_RunAll::InitTest( lua::LuaStack& stack, InitError&, const char* suiteName, const char* functionName, lua::LuaStackValue& function )
 {
 	TestClosure* pClosure = CORE_NEW TestClosure();
+	pClosure->refKey = lua::LUA_NO_REF;
 
-	lua::LuaState thread = stack.NewThread();
+	Host& host = Host::GetHost( stack.InternalState() );
+	lua::LuaState thread = host.Coroutines().Acquire( pClosure->process, pClosure->refKey );
 	function.PushValue();
 	stack.XMove( thread.GetStack(), 1 );
 
-	pClosure->process.SetLuaThread( thread );
 	pClosure->process.SetParentProcess( ThisProcess() );
-	pClosure->refKey = stack.RefInRegistry();
 	
 	pClosure->suiteName = suiteName;
 	pClosure->functionName = functionName;
@@ -288,7 +283,7 @@ int csp::TestSuite_new( lua_State* luaState )
 
 int csp::TestSuite_RUN_ALL( lua_State* luaState )
 {
-	OpTestSuite_RunAll* pRunAll = CORE_NEW OpTestSuite_RunAll();
+	OpTestSuite_RunAll* pRunAll = new( Host::GetHost( luaState ) ) OpTestSuite_RunAll();
 	return pRunAll->DoInit( luaState );
 }
 
@@ -35,6 +35,7 @@ namespace csp
 		virtual bool Init( lua::LuaStack& args, InitError& initError );
 		virtual WorkResult::Enum Evaluate( Host& host );
 		virtual WorkResult::Enum Work( Host& host, CspTime_t dt );
+		virtual bool RequiresWork() const;
 		virtual void Terminate( Host& host );
 
 		virtual void SetCheckFailed();
@@ -56,8 +57,8 @@ namespace csp
 			int numChecksFailed;
 		};
 
-		void UnrefClosure( TestClosure* pClosure );
-		void UnrefClosures( TestClosure* pHead );
+		void UnrefClosure( Host& host, TestClosure* pClosure );
+		void UnrefClosures( Host& host, TestClosure* pHead );
 		static void DeleteClosures( TestClosure*& pHead, TestClosure*& pTail );
 
 		static TestClosure* ListPopFromHead( TestClosure*& pHead, TestClosure*& pTail );
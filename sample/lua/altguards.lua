@@ -0,0 +1,48 @@
+-- ALT guard count benchmark: a reader waits on N channels at once while a writer picks a different one each time.
+-- Every round is one ALT_ARRAY (the same case machinery as ALT) which registers all N guards and fires one of them.
+-- Then every guarded channel is closed under a waiting ALT. Time it externally, one N at a time.
+
+local GUARD_COUNTS = { 10, 100, 1000, 10000 }
+local ROUNDS = 1000
+
+local function altGuards( numGuards )
+	local channels = {}
+	for i = 1, numGuards do
+		channels[ i ] = Channel:new()
+	end
+
+	local function handler( index, value )
+	end
+
+	PAR(
+		function()
+			for i = 1, ROUNDS do
+				-- walks the guards from the last one: the worst case for a linear scan
+				channels[ numGuards - i % numGuards ]:OUT( i )
+			end
+		end,
+		function()
+			for i = 1, ROUNDS do
+				ALT_ARRAY( channels, handler )
+			end
+		end
+	)
+
+	PAR(
+		function()
+			ALT_ARRAY( channels, handler )
+		end,
+		function()
+			SLEEP( 0 ) -- lets the ALT wait
+			for i = 1, numGuards do
+				channels[ i ]:close()
+			end
+		end
+	)
+end
+
+function main()
+	for i = 1, #GUARD_COUNTS do
+		altGuards( GUARD_COUNTS[ i ] )
+	end
+end
@@ -0,0 +1,43 @@
+-- Channel argument benchmark: a writer sends messages of 1, 4 and 16 values to a reader over an unbuffered channel.
+-- Every message is one rendezvous which moves the values between the two thread stacks.
+-- The message count is the same for every size: time it externally, one size at a time.
+
+local ARGUMENT_COUNTS = { 1, 4, 16 }
+local MESSAGES = 200000
+
+local senders =
+{
+	[1] = function( ch, i )
+		ch:OUT( i )
+	end,
+	[4] = function( ch, i )
+		ch:OUT( i, i, i, i )
+	end,
+	[16] = function( ch, i )
+		ch:OUT( i, i, i, i, i, i, i, i, i, i, i, i, i, i, i, i )
+	end,
+}
+
+local function transfer( numArguments )
+	local ch = Channel:new()
+	local send = senders[ numArguments ]
+
+	PAR(
+		function()
+			for i = 1, MESSAGES do
+				send( ch, i )
+			end
+		end,
+		function()
+			for i = 1, MESSAGES do
+				ch:IN()
+			end
+		end
+	)
+end
+
+function main()
+	for i = 1, #ARGUMENT_COUNTS do
+		transfer( ARGUMENT_COUNTS[ i ] )
+	end
+end
@@ -0,0 +1,24 @@
+-- Ping-pong benchmark: two processes bounce a counter over a pair of unbuffered channels.
+-- Every round trip is two rendezvous. Time it externally: elementary:pingPongEvalSteps checks the eval steps it takes.
+
+local ROUND_TRIPS = 200000
+
+function main()
+	local ping = Channel:new()
+	local pong = Channel:new()
+
+	PAR(
+		function()
+			for i = 1, ROUND_TRIPS do
+				ping:OUT( i )
+				pong:IN()
+			end
+		end,
+		function()
+			for i = 1, ROUND_TRIPS do
+				local value = ping:IN()
+				pong:OUT( value )
+			end
+		end
+	)
+end
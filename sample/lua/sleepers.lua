@@ -0,0 +1,36 @@
+-- Timer queue benchmark: 100k processes sleep repeatedly, each for its own period of 1 to 97 ticks.
+-- Every SLEEP schedules a deadline among 100k pending ones, every tick expires the ones which are due.
+-- Time it externally.
+
+local SLEEPERS = 100000
+local SLEEPS_PER_SLEEPER = 10
+
+function main()
+	local swarm = Swarm:new()
+	local done = Channel:new()
+
+	local function sleeper( seconds )
+		for i = 1, SLEEPS_PER_SLEEPER do
+			SLEEP( seconds )
+		end
+		done:OUT()
+	end
+
+	PARWHILE(
+		function()
+			SLEEP( 0 ) -- lets the swarm MAIN start
+			for i = 1, SLEEPERS do
+				local seconds = ( i % 97 + 1 ) / 60
+				swarm:go( function()
+					sleeper( seconds )
+				end )
+			end
+			for i = 1, SLEEPERS do
+				done:IN()
+			end
+		end,
+		function()
+			swarm:MAIN()
+		end
+	)
+end
@@ -0,0 +1,38 @@
+-- Swarm churn benchmark: keeps N workers alive in a swarm while they complete and get replaced.
+-- Every round releases one waiting worker, which completes, and spawns its replacement.
+-- The rounds are the same for every N: time it externally, one N at a time.
+
+local CONCURRENT_WORKERS = { 1000, 10000, 100000 }
+local CHURN_ROUNDS = 20000
+
+local function churn( numWorkers )
+	local swarm = Swarm:new()
+	local gate = Channel:new()
+
+	local function worker()
+		gate:IN()
+	end
+
+	PARWHILE(
+		function()
+			SLEEP( 0 ) -- lets the swarm MAIN start
+			for i = 1, numWorkers do
+				swarm:go( worker )
+			end
+			SLEEP( 0 ) -- lets all the workers start
+			for i = 1, CHURN_ROUNDS do
+				gate:OUT()
+				swarm:go( worker )
+			end
+		end,
+		function()
+			swarm:MAIN()
+		end
+	)
+end
+
+function main()
+	for i = 1, #CONCURRENT_WORKERS do
+		churn( CONCURRENT_WORKERS[ i ] )
+	end
+end
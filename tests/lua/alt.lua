@@ -160,3 +160,316 @@ function testalt:timeGuard()
 	checkEquals("wrong flow", "f1234569", flow )
 end
 
+
+function testalt:loopWithDeepBranches()
+	startTickCheck( self )
+	local ch = Channel:new()
+	local done = Channel:new()
+	local sum = 0
+	local depth = 0
+
+	local function recurse( n )
+		if n == 0 then return 0 end
+		return 1 + recurse( n-1 )
+	end
+
+	PAR(
+		function()
+			for i=1,1000 do
+				ch:OUT( i )
+			end
+			done:OUT()
+		end,
+		function()
+			local running = true
+			while running do
+				ALT(
+					ch, function( value )
+						sum = sum + value
+						-- grows the stack of the calling thread
+						if value % 100 == 0 then depth = depth + recurse( 500 ) end
+					end
+					,
+					done, function()
+						running = false
+					end
+				)
+			end
+		end
+	)
+
+	checkEquals("values lost", 500500, sum )
+	checkEquals("wrong depth", 5000, depth )
+	endTickCheck( self, 0)
+end
+
+function testalt:inlineHandlers()
+	startTickCheck( self )
+	local ch1 = Channel:new()
+	local ch2 = Channel:new()
+	local flow = "f"
+
+	PAR(
+		function()
+			ALT(
+				ch1, function( value )
+					flow = flow .. value
+					-- blocks the caller itself
+					flow = flow .. ch2:IN()
+					ALT(
+						ch1, function( nested )
+							flow = flow .. nested
+						end
+					)
+					flow = flow .. "4"
+				end
+			)
+			flow = flow .. "5"
+		end,
+		function()
+			ch1:OUT( 1 )
+			ch2:OUT( 2 )
+			ch1:OUT( 3 )
+		end
+	)
+	checkEquals( "wrong flow", "f12345", flow )
+
+	-- a handler blocked in the caller is terminated with it
+	PARWHILE(
+		function()
+			ch1:OUT( 6 )
+		end,
+		function()
+			ALT(
+				ch1, function( value )
+					flow = flow .. value
+					ch2:IN()
+					flow = flow .. "x"
+				end
+			)
+		end
+	)
+	checkEquals( "wrong flow", "f123456", flow )
+
+	endTickCheck( self, 0)
+end
+
+function testalt:argumentsWithNils()
+	startTickCheck( self )
+	local ch = Channel:new()
+	local received = nil
+
+	PAR(
+		function()
+			ch:OUT( 1, nil, "x", nil )
+			ch:OUT( nil, nil )
+		end,
+		function()
+			ALT(
+				ch, function( ... )
+					received = { n = select( "#", ... ), ... }
+				end
+			)
+			checkEquals( "wrong number of values", 4, received.n )
+			checkEquals( "wrong value", 1, received[1] )
+			checkEquals( "wrong value", nil, received[2] )
+			checkEquals( "wrong value", "x", received[3] )
+
+			checkEquals( "wrong number of values", 2, select( "#", ch:IN() ) )
+		end
+	)
+	endTickCheck( self, 0)
+end
+
+function testalt:manyGuards()
+	startTickCheck( self )
+	local numGuards = 500
+	local channels = {}
+	local args = {}
+	local triggered = {}
+
+	for i=1,numGuards do
+		channels[i] = Channel:new()
+		args[2*i-1] = channels[i]
+		args[2*i] = function( value )
+			triggered[ #triggered+1 ] = i*10 + value
+		end
+	end
+
+	PAR(
+		function()
+			channels[400]:OUT( 1 )
+		end,
+		function()
+			channels[300]:OUT( 2 )
+		end,
+		function()
+			-- both are ready on start: the first guard wins
+			ALT( table.unpack( args ) )
+			ALT( table.unpack( args ) )
+		end
+	)
+	checkEqualsArray( "wrong guards triggered", { 3002, 4001 }, triggered )
+
+	PAR(
+		function()
+			ALT( table.unpack( args ) )
+		end,
+		function()
+			SLEEP(0)
+			channels[123]:OUT( 3 )
+		end
+	)
+	checkEqualsArray( "wrong guard triggered", { 3002, 4001, 1233 }, triggered )
+
+	PAR(
+		function()
+			ALT( table.unpack( args ) )
+		end,
+		function()
+			SLEEP(0)
+			for i=1,numGuards do
+				channels[i]:close()
+			end
+		end
+	)
+	checkEquals( "closed guards triggered", 3, #triggered )
+	endTickCheck( self, 2 )
+end
+
+function testalt:altArray()
+	startTickCheck( self )
+	local channels = {}
+	for i=1,300 do
+		channels[i] = Channel:new()
+	end
+	local received = {}
+	local function handler( index, ... )
+		received = { index = index, n = select( "#", ... ), ... }
+	end
+
+	PAR(
+		function()
+			ALT_ARRAY( channels, handler )
+		end,
+		function()
+			channels[250]:OUT( "a", nil )
+		end
+	)
+	checkEquals( "wrong index", 250, received.index )
+	checkEquals( "wrong number of values", 2, received.n )
+	checkEquals( "wrong value", "a", received[1] )
+
+	local buffered = Channel:new( 1 )
+	buffered:OUT( "b" )
+	ALT_ARRAY( { channels[1], buffered }, handler )
+	checkEquals( "wrong index", 2, received.index )
+	checkEquals( "wrong value", "b", received[1] )
+
+	-- the channels stay alive even if the array changes meanwhile
+	local array = { Channel:new(), Channel:new() }
+	local ch = array[2]
+	PAR(
+		function()
+			ALT_ARRAY( array, handler )
+		end,
+		function()
+			array[1] = nil
+			array[2] = nil
+			collectgarbage()
+			ch:OUT( "c" )
+		end
+	)
+	checkEquals( "wrong index", 2, received.index )
+	checkEquals( "wrong value", "c", received[1] )
+
+	received = nil
+	ALT_ARRAY( {}, handler )
+	checkEquals( "handler called without channels", nil, received )
+
+	endTickCheck( self, 0 )
+end
+
+function testalt:altArrayTimeGuard()
+	local t1 = time()
+	local channels = { Channel:new(), Channel:new() }
+	local received
+
+	ALT_ARRAY( channels, function( ... )
+		received = { n = select( "#", ... ) }
+	end, time() + 0.2 )
+
+	checkEqualsFloat( "wrong timing", 0.2, time()-t1, 0.02 )
+	checkEquals( "time guard handler takes no index", 0, received.n )
+
+	PAR(
+		function()
+			ALT_ARRAY( channels, function( index ) received = index end )
+		end,
+		function()
+			channels[1]:close()
+			channels[2]:close()
+		end
+	)
+	checkEquals( "closed channels triggered", 0, received.n )
+end
+
+function testalt:selector()
+	startTickCheck( self )
+	local ch1 = Channel:new()
+	local ch2 = Channel:new()
+	local buffered = Channel:new( 2 )
+	local flow = "f"
+
+	local sel = Selector:new(
+		ch1, function( value ) flow = flow..value end,
+		ch2, function( value ) flow = flow.."-"..value end,
+		buffered, function( value ) flow = flow.."+"..value end
+	)
+
+	PAR(
+		function()
+			for i=1,4 do
+				sel:SELECT()
+			end
+		end,
+		function()
+			ch2:OUT( 1 )
+			ch1:OUT( 2 )
+			buffered:OUT( 3 )
+			ch2:OUT( 4 )
+		end
+	)
+	checkEquals( "wrong flow", "f-12+3-4", flow )
+
+	local ok
+	PAR(
+		function()
+			sel:SELECT()
+		end,
+		function()
+			ok = pcall( sel.SELECT, sel )
+			ch1:OUT( 5 )
+		end
+	)
+	checkEquals( "a selector selects once at a time", false, ok )
+	checkEquals( "wrong flow", "f-12+3-45", flow )
+
+	ch1:close()
+	PAR(
+		function()
+			sel:SELECT()
+		end,
+		function()
+			ch2:OUT( 6 )
+		end
+	)
+	checkEquals( "wrong flow", "f-12+3-45-6", flow )
+
+	ch2:close()
+	buffered:close()
+	sel:SELECT()
+	checkEquals( "closed guards triggered", "f-12+3-45-6", flow )
+
+	endTickCheck( self, 0 )
+end
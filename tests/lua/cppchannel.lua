@@ -0,0 +1,77 @@
+cppchannel = TestSuite:new()
+
+function cppchannel:typedInPlace()
+	local ch = Channel:new()
+	local idSum, numConverted
+
+	PAR(
+		function()
+			PRODUCE_SAMPLES( ch, 10 )
+		end,
+		function()
+			idSum, numConverted = SUM_SAMPLES( ch, 10 )
+		end
+	)
+
+	checkEqualsInt( "sum of ids", 55, idSum )
+	checkEqualsInt( "payloads converted to Lua values", 0, numConverted )
+end
+
+function cppchannel:typedToLua()
+	local ch = Channel:new()
+	local ids = {}
+	local values = {}
+
+	PAR(
+		function()
+			PRODUCE_SAMPLES( ch, 3 )
+		end,
+		function()
+			for i=1,3 do
+				ids[i], values[i] = ch:IN()
+			end
+		end
+	)
+
+	checkEqualsArray( "ids", {1,2,3}, ids )
+	checkEqualsArray( "values", {0.5,1,1.5}, values )
+end
+
+function cppchannel:luaToTyped()
+	local ch = Channel:new()
+	local idSum, numConverted
+
+	PAR(
+		function()
+			for i=1,3 do
+				ch:OUT( i, "ignored" )
+			end
+		end,
+		function()
+			idSum, numConverted = SUM_SAMPLES( ch, 3 )
+		end
+	)
+
+	checkEqualsInt( "sum of ids", 6, idSum )
+	checkEqualsInt( "payloads converted from Lua values", 3, numConverted )
+end
+
+function cppchannel:typedBuffered()
+	local ch = Channel:new( 4 )
+	local idSum
+
+	PRODUCE_SAMPLES( ch, 4 )
+	local id = ch:IN()
+	checkEqualsInt( "first buffered id", 1, id )
+
+	PAR(
+		function()
+			PRODUCE_SAMPLES( ch, 10 )
+		end,
+		function()
+			idSum = SUM_SAMPLES( ch, 13 )
+		end
+	)
+
+	checkEqualsInt( "sum of ids", 2+3+4+55, idSum )
+end
@@ -7,6 +7,70 @@ function elementary:sleep1tick()
 	endTickCheck( self, 1)
 end
 
+function elementary:pingPongEvalSteps()
+	startTickCheck( self )
+
+	local ping = Channel:new()
+	local pong = Channel:new()
+	local roundTrips = 100
+	local before = stats().numEvalSteps
+
+	-- the same as sample/lua/pingpong.lua
+	PAR(
+		function()
+			for i = 1, roundTrips do
+				ping:OUT( i )
+				pong:IN()
+			end
+		end,
+		function()
+			for i = 1, roundTrips do
+				local value = ping:IN()
+				pong:OUT( value )
+			end
+		end
+	)
+
+	-- a rendezvous resumes the reader directly: three steps per rendezvous, PAR takes four more
+	checkEqualsInt( "eval steps", 6 * roundTrips + 4, stats().numEvalSteps - before )
+	endTickCheck( self, 0)
+end
+
+function elementary:steadyTrafficNoHeap()
+	startTickCheck( self )
+
+	local ping = Channel:new()
+	local pong = Channel:new()
+
+	local function traffic( rounds )
+		PAR(
+			function()
+				for i = 1, rounds do
+					ping:OUT( i )
+					pong:IN()
+				end
+			end,
+			function()
+				for i = 1, rounds do
+					ALT(
+						ping, function( value )
+							pong:OUT( value )
+						end
+					)
+				end
+			end
+		)
+	end
+
+	-- the first rounds fill the block allocator and the coroutine pool
+	traffic( 10 )
+	local before = stats().numHeapAllocations
+	traffic( 1000 )
+
+	checkEqualsInt( "heap allocations", 0, stats().numHeapAllocations - before )
+	endTickCheck( self, 0)
+end
+
 function elementary:inAndOut()
 	startTickCheck( self )
 
@@ -83,6 +147,94 @@ end
 
 
 
+function elementary:swarmChurn()
+	local swarm = Swarm:new()
+	local gate = Channel:new()
+	local numDone = 0
+
+	local function worker()
+		local value = gate:IN()
+		numDone = numDone + value
+	end
+	local function quickWorker()
+		numDone = numDone + 1
+	end
+
+	PARWHILE(
+		function()
+			SLEEP(0)
+			for i = 1, 50 do
+				swarm:go( worker, quickWorker )
+			end
+			SLEEP(0)
+			checkEqualsInt( "quick workers not finished", 50, numDone )
+			-- workers finish in any order, each one is replaced
+			for i = 1, 100 do
+				gate:OUT( 1 )
+				swarm:go( worker )
+			end
+			for i = 1, 50 do
+				gate:OUT( 1 )
+			end
+			SLEEP(0)
+		end,
+		function()
+			swarm:MAIN()
+		end
+	)
+
+	checkEqualsInt( "workers not finished", 200, numDone )
+end
+
+function elementary:swarmBounded()
+	local swarm = Swarm:new{ maxConcurrent = 2, highWater = 3 }
+	local gate = Channel:new()
+	local done = Channel:new()
+	local errMsg = "bounded swarm error"
+	local numRunning, maxRunning, numDone, numQueued = 0, 0, 0, 0
+
+	local function worker()
+		numRunning = numRunning + 1
+		if numRunning > maxRunning then
+			maxRunning = numRunning
+		end
+		gate:IN()
+		numRunning = numRunning - 1
+		numDone = numDone + 1
+	end
+
+	PARWHILE(
+		function()
+			SLEEP(0)
+			for i = 1, 6 do
+				swarm:go( worker )
+				numQueued = i
+			end
+			done:IN()
+		end,
+		function()
+			swarm:MAIN()
+		end,
+		function()
+			SLEEP(0)
+			SLEEP(0)
+			checkEqualsInt( "go must block over the high-water mark", 5, numQueued )
+			checkEqualsInt( errMsg, 2, numRunning )
+			for i = 1, 6 do
+				gate:OUT()
+			end
+			SLEEP(0)
+			checkEqualsInt( errMsg, 6, numQueued )
+			checkEqualsInt( errMsg, 6, numDone )
+			done:OUT()
+		end
+	)
+
+	checkEqualsInt( "too many closures at once", 2, maxRunning )
+	checkEquals( errMsg, false, pcall( Swarm.new, Swarm, { maxConcurrent = -1 } ) )
+	checkEquals( errMsg, false, pcall( Swarm.new, Swarm, 2 ) )
+end
+
 Stages = Contract:table()
 Stages.stage1 = Channel
 Stages.stage2 = Channel
@@ -110,6 +262,46 @@ function elementary:contract()
 	endTickCheck( self, 0)
 end
 
+function elementary:contractRecycle()
+	local errMsg = "contract channels error"
+
+	local c = Stages:new()
+	checkEquals( "channels are created on the first access", nil, rawget( c, "stage1" ) )
+	local stage1 = c.stage1
+	checkEquals( errMsg, true, rawequal( stage1, c.stage1 ) )
+	checkEquals( errMsg, nil, rawget( c, "stage2" ) )
+	checkEquals( errMsg, nil, c.unknown )
+
+	local stage2 = c.stage2
+	stage2:close()
+	Stages:recycle( c )
+	Stages:recycle( c )
+
+	local c2 = Stages:new()
+	checkEquals( "recycled instance expected", true, rawequal( c, c2 ) )
+	checkEquals( errMsg, true, rawequal( stage1, c2.stage1 ) )
+	checkEquals( "closed channel is renewed", false, rawequal( stage2, c2.stage2 ) )
+	checkEquals( "instance is pooled once", false, rawequal( c2, Stages:new() ) )
+
+	local stage3 = c2.stage3
+	local v = 0
+	PAR(
+		function()
+			stage3:OUT( 1 )
+		end,
+		function()
+			SLEEP(0)
+			Stages:recycle( c2 )
+			checkEquals( "busy channel is renewed", false, rawequal( stage3, Stages:new().stage3 ) )
+			v = stage3:IN()
+		end
+	)
+	checkEqualsInt( errMsg, 1, v )
+
+	checkEquals( errMsg, false, pcall( Stages.recycle, Stages, {} ) )
+	checkEquals( errMsg, false, pcall( Stages.recycle, Stages, Contract:table():new() ) )
+end
+
 function elementary:range()
 	startTickCheck( self )
 
@@ -167,3 +359,646 @@ function elementary:surviveGc()
 	endTickCheck( self, 0)
 end
 
+
+function elementary:manySleepers()
+	local t1 = time()
+	local woken = 0
+	local early = 0
+
+	local sleepers = {}
+	for i = 1, 1000 do
+		local seconds = ( i % 10 ) * 0.1
+		sleepers[i] = function()
+			SLEEP( seconds )
+			if time() - t1 < seconds then
+				early = early + 1
+			end
+			woken = woken + 1
+		end
+	end
+	PAR( table.unpack( sleepers ) )
+
+	checkEqualsInt( "not all sleepers woken", 1000, woken )
+	checkEqualsInt( "sleepers woken too early", 0, early )
+	checkEqualsFloat( "wrong timing", 0.9, time()-t1, 0.02 )
+end
+
+function elementary:massWakeUp()
+	local t1 = time()
+	local woken = 0
+	local ticks = {}
+
+	local sleepers = {}
+	for i = 1, 10000 do
+		sleepers[i] = function()
+			SLEEP( 0.5 )
+			ticks[ tick() ] = true
+			woken = woken + 1
+		end
+	end
+	PAR( table.unpack( sleepers ) )
+
+	local numTicks = 0
+	for _ in pairs( ticks ) do numTicks = numTicks + 1 end
+
+	checkEqualsInt( "not all sleepers woken", 10000, woken )
+	checkEqualsInt( "sleepers woken in different ticks", 1, numTicks )
+end
+
+function elementary:crossHostChannel()
+	startTickCheck( self )
+
+	local ch = CrossHostChannel:new( 2 )
+	local received = {}
+
+	ch:OUT( "a\0b", 1 )
+	ch:OUT( true, nil, 3.5 )
+	endTickCheck( self, 0 )
+
+	PAR(
+		function()
+			ch:OUT( "blocked" ) -- the ring is full: waits for the reader
+		end,
+		function()
+			sleepTicks( 2 )
+			for i = 1, 3 do
+				received[i] = { ch:IN() }
+			end
+		end
+	)
+
+	checkEquals( "wrong string", "a\0b", received[1][1] )
+	checkEqualsInt( "wrong number", 1, received[1][2] )
+	checkEquals( "wrong boolean", true, received[2][1] )
+	checkEquals( "wrong nil", nil, received[2][2] )
+	checkEqualsFloat( "wrong number", 3.5, received[2][3], 0 )
+	checkEquals( "wrong last message", "blocked", received[3][1] )
+end
+
+function elementary:crossHostCapacity()
+	for _, capacity in ipairs( { 1, 3 } ) do
+		local ch = CrossHostChannel:new( capacity )
+		local numSent = 0
+
+		PAR(
+			function()
+				for i = 1, capacity + 1 do
+					ch:OUT( i )
+					numSent = numSent + 1
+				end
+			end,
+			function()
+				SLEEP(0)
+				-- the ring is rounded up to a power of two, the capacity is not
+				checkEqualsInt( "messages queued beyond the capacity", capacity, numSent )
+				for i = 1, capacity + 1 do
+					checkEqualsInt( "wrong message", i, ch:IN() )
+				end
+			end
+		)
+	end
+end
+
+function elementary:hostPool()
+	local numHosts, numTicks = 8, 20
+	local numCompleted, numPoolTicks = RUN_HOST_POOL( 4, numHosts, numTicks )
+
+	checkEqualsInt( "hosts which counted every tick", numHosts, numCompleted )
+	checkEqualsInt( "pool ticks", numTicks, numPoolTicks )
+end
+
+function elementary:crossHostTransfer()
+	local count = 2000
+	local received, sum, outOfOrder = CROSS_HOST_TRANSFER( count, 4 )
+
+	checkEqualsInt( "messages received", count, received )
+	checkEqualsInt( "sum of values", count * ( count + 1 ) / 2, sum )
+	checkEqualsInt( "messages out of order", 0, outOfOrder )
+end
+
+function elementary:preemption()
+	local t1 = tick()
+	local sum = 0
+	local ticked = false
+	local tickedBeforeBusyEnd
+
+	PAR(
+		function()
+			-- never calls a CSP operation: runs over the tick budget
+			for i = 1, 3000000 do
+				sum = sum + i
+			end
+			tickedBeforeBusyEnd = ticked
+		end,
+		function()
+			SLEEP(0)
+			ticked = true
+		end
+	)
+
+	checkEquals( "busy process wasn't preempted", true, tick() - t1 > 1 )
+	checkEquals( "sibling process starved", true, tickedBeforeBusyEnd )
+	checkEqualsFloat( "wrong sum", 3000000 * 3000001 / 2, sum, 0 )
+end
+
+function elementary:longSleep()
+	local t1 = time()
+	local tick1 = tick()
+
+	SLEEP( 3600 )
+
+	checkEqualsFloat( "wrong timing", 3600, time()-t1, 0.02 )
+	checkEqualsFloat( "wrong tick count", 3600 * 60, tick()-tick1, 1 )
+end
+
+function elementary:manyArguments()
+	startTickCheck( self )
+
+	local ch = Channel:new()
+	local values = {}
+	for i=1,300 do values[i] = i end
+
+	PAR(
+		function()
+			for i=1,100 do
+				ch:OUT( i, i*2 )
+			end
+			-- too many arguments for the pooled size classes
+			ch:OUT( table.unpack( values ) )
+		end,
+		function()
+			local sum = 0
+			for i=1,100 do
+				local a, b = ch:IN()
+				sum = sum + b - a
+			end
+			checkEquals( "communication error", 5050, sum )
+
+			local received = { ch:IN() }
+			checkEquals( "communication error", 300, #received )
+			checkEquals( "communication error", 300, received[300] )
+		end
+	)
+
+	endTickCheck( self, 0)
+end
+
+function elementary:bufferedChannel()
+	startTickCheck( self )
+
+	local ch = Channel:new( 3 )
+	local errMsg = "buffered communication error"
+
+	-- OUT completes at once while the buffer has room
+	ch:OUT( "a" )
+	ch:OUT( nil, 2 )
+	ch:OUT()
+
+	local a = ch:IN()
+	checkEquals( errMsg, "a", a )
+	local n, two = ch:IN()
+	checkEquals( errMsg, nil, n )
+	checkEquals( errMsg, 2, two )
+	checkEquals( errMsg, 0, select( "#", ch:IN() ) )
+
+	local values = {}
+	for i=1,50 do values[i] = i end
+
+	local sum = 0
+	PAR(
+		function()
+			-- the writer blocks on the full buffer, messages of different sizes make the slots wrap and grow
+			for i=1,50 do
+				ch:OUT( table.unpack( values, 1, i ) )
+			end
+			ch:close()
+		end,
+		function()
+			local i = 0
+			for status, first, second in ch:RANGE() do
+				i = i + 1
+				checkEquals( errMsg, 1, first )
+				sum = sum + ( second or 0 )
+				SLEEP(0)
+			end
+			checkEqualsInt( errMsg, 50, i )
+		end
+	)
+	checkEqualsInt( errMsg, 49*2, sum )
+
+	endTickCheck( self, 50 )
+end
+
+function elementary:bufferedChannelClose()
+	startTickCheck( self )
+
+	local ch = Channel:new( 4 )
+	local flow = ""
+
+	PAR(
+		function()
+			ch:OUT( 1 )
+			ch:OUT( 2 )
+			ch:close()
+			flow = flow.."c"
+		end,
+		function()
+			SLEEP(0)
+			-- buffered values stay readable after close
+			flow = flow..ch:IN()
+			ALT(
+				ch, function( value )
+					flow = flow..value
+				end
+			)
+			checkEquals( "closed channel error", 0, select( "#", ch:IN() ) )
+		end
+	)
+
+	checkEquals( "buffered close error", "c12", flow )
+	endTickCheck( self, 1 )
+end
+
+function elementary:sharedChannel()
+	startTickCheck( self )
+
+	local jobs = Channel:new()
+	local results = Channel:new()
+	local errMsg = "shared channel error"
+
+	local swarm = Swarm:new()
+	local served = {}
+	local done = Channel:new()
+	local sum = 0
+	PARWHILE(
+		function()
+			done:IN()
+		end,
+		function()
+			swarm:MAIN()
+		end,
+		function()
+			for worker=1,4 do
+				swarm:go(
+					function()
+						for status, job in jobs:RANGE() do
+							served[ worker ] = ( served[ worker ] or 0 ) + 1
+							SLEEP(0)
+							results:OUT( job * 2 )
+						end
+					end
+				)
+			end
+
+			-- two producers share the job channel
+			PAR(
+				function()
+					for i=1,10 do jobs:OUT( i ) end
+				end,
+				function()
+					for i=11,20 do jobs:OUT( i ) end
+				end,
+				function()
+					for i=1,20 do sum = sum + results:IN() end
+				end
+			)
+			jobs:close()
+			done:OUT()
+		end
+	)
+
+	checkEqualsInt( errMsg, 420, sum )
+	for worker=1,4 do
+		checkEquals( errMsg, true, served[ worker ] ~= nil )
+	end
+
+	endTickCheck( self, 5 )
+end
+
+function elementary:sharedChannelAltAndTerminate()
+	startTickCheck( self )
+
+	local ch = Channel:new()
+	local flow = ""
+
+	PAR(
+		function()
+			PARWHILE(
+				function()
+					SLEEP(0)
+				end,
+				function()
+					-- queued before the other readers, terminated while waiting
+					ch:IN()
+					flow = flow.."-"
+				end
+			)
+			flow = flow.."1"
+			ch:OUT( "a" )
+			ch:OUT( "b" )
+		end,
+		function()
+			local value = ch:IN()
+			flow = flow..value
+		end,
+		function()
+			ALT(
+				ch, function( value )
+					flow = flow..value
+				end
+			)
+		end
+	)
+
+	-- the terminated reader is skipped, the others are served in turn
+	checkEquals( "shared channel error", true, flow == "1ab" or flow == "1ba" )
+	endTickCheck( self, 1 )
+end
+
+function elementary:manyItems()
+	startTickCheck( self )
+
+	local ch = Channel:new()
+	local errMsg = "batched communication error"
+
+	local samples = {}
+	for i=1,10 do samples[i] = i end
+
+	PAR(
+		function()
+			-- one rendezvous moves up to maxCount items
+			local items, n = ch:IN_MANY( 4 )
+			checkEqualsInt( errMsg, 4, n )
+			checkEqualsArray( errMsg, { 1, 2, 3, 4 }, items )
+
+			items, n = ch:IN_MANY( 100 )
+			checkEqualsInt( errMsg, 6, n )
+			checkEqualsInt( errMsg, 10, items[6] )
+
+			-- plain OUT messages are items too
+			items, n = ch:IN_MANY( 2 )
+			checkEqualsInt( errMsg, 1, n )
+			checkEquals( errMsg, "x", items[1] )
+		end,
+		function()
+			checkEqualsInt( errMsg, 10, ch:OUT_MANY( samples ) )
+			SLEEP(0)
+			ch:OUT( "x", "dropped" )
+		end
+	)
+
+	-- an OUT_MANY writer serves several readers
+	local sum = 0
+	PAR(
+		function() local v = ch:IN(); sum = sum + v end,
+		function() local v = ch:IN(); sum = sum + v end,
+		function() ch:OUT_MANY( { 20, 22 } ) end
+	)
+	checkEqualsInt( errMsg, 42, sum )
+
+	-- the reader comes to a blocked writer and returns at once
+	PAR(
+		function() ch:OUT_MANY( { 1, 2 } ) end,
+		function()
+			SLEEP(0)
+			ch:IN_MANY( 2 )
+		end
+	)
+
+	endTickCheck( self, 2 )
+end
+
+function elementary:manyItemsBuffered()
+	startTickCheck( self )
+
+	local ch = Channel:new( 4 )
+	local errMsg = "batched buffered communication error"
+
+	checkEqualsInt( errMsg, 3, ch:OUT_MANY( { "a", "b", "c" } ) )
+
+	local samples = {}
+	for i=1,20 do samples[i] = i end
+
+	local received = 0
+	PAR(
+		function()
+			-- doesn't fit into the buffer: blocks until the reader drains it
+			checkEqualsInt( errMsg, 20, ch:OUT_MANY( samples ) )
+			ch:close()
+		end,
+		function()
+			local items, n = ch:IN_MANY( 2 )
+			checkEqualsArray( errMsg, { "a", "b" }, items )
+			SLEEP(0)
+			while true do
+				items, n = ch:IN_MANY( 8 )
+				if n == 0 then break end
+				received = received + n
+			end
+		end
+	)
+	checkEqualsInt( errMsg, 21, received )
+
+	-- a closed channel cuts OUT_MANY short
+	local ch2 = Channel:new()
+	PAR(
+		function()
+			checkEqualsInt( errMsg, 1, ch2:OUT_MANY( { 1, 2, 3 } ) )
+		end,
+		function()
+			ch2:IN()
+			ch2:close()
+		end
+	)
+
+	endTickCheck( self, 1 )
+end
+
+function elementary:tryInAndOut()
+	startTickCheck( self )
+
+	local ch = Channel:new()
+	local errMsg = "polling communication error"
+
+	checkEquals( errMsg, false, ch:TRY_IN() )
+	checkEquals( errMsg, false, ch:TRY_OUT( 1 ) )
+
+	-- a blocked writer completes the rendezvous synchronously
+	PAR(
+		function()
+			ch:OUT( "a", nil )
+			ch:OUT_MANY( { "b", "c" } )
+		end,
+		function()
+			SLEEP(0)
+			local received = table.pack( ch:TRY_IN() )
+			checkEqualsInt( errMsg, 3, received.n )
+			checkEquals( errMsg, true, received[1] )
+			checkEquals( errMsg, "a", received[2] )
+			checkEquals( errMsg, false, ch:TRY_IN() )
+			SLEEP(0)
+			local ok, value = ch:TRY_IN()
+			checkEquals( errMsg, "b", value )
+			checkEquals( errMsg, "c", ch:IN() )
+		end
+	)
+
+	-- a waiting reader or ALT takes the values
+	local received = nil
+	PAR(
+		function()
+			received = { ch:IN() }
+			ALT(
+				ch, function( value )
+					received = value
+				end
+			)
+		end,
+		function()
+			checkEquals( errMsg, true, ch:TRY_OUT( 1, 2 ) )
+			-- the reader isn't attached again until it runs
+			checkEquals( errMsg, false, ch:TRY_OUT( 3 ) )
+			SLEEP(0)
+			checkEqualsArray( errMsg, { 1, 2 }, received )
+			checkEquals( errMsg, true, ch:TRY_OUT( 4 ) )
+		end
+	)
+	checkEquals( errMsg, 4, received )
+
+	local buffered = Channel:new( 1 )
+	checkEquals( errMsg, true, buffered:TRY_OUT( 5 ) )
+	checkEquals( errMsg, false, buffered:TRY_OUT( 6 ) )
+	buffered:close()
+	checkEquals( errMsg, nil, buffered:TRY_OUT( 7 ) )
+
+	local ok, value = buffered:TRY_IN()
+	checkEquals( errMsg, true, ok )
+	checkEquals( errMsg, 5, value )
+	checkEquals( errMsg, nil, buffered:TRY_IN() )
+
+	endTickCheck( self, 3 )
+end
+
+function elementary:timeouts()
+	local t1 = time()
+	local ch = Channel:new()
+	local errMsg = "communication with timeout error"
+
+	local value, reason = ch:IN_TIMEOUT( 0.5 )
+	checkEquals( errMsg, nil, value )
+	checkEquals( errMsg, "timeout", reason )
+	checkEqualsFloat( "wrong timing", 0.5, time()-t1, 0.02 )
+
+	local ok
+	ok, reason = ch:OUT_TIMEOUT( 0.5, 1, 2 )
+	checkEquals( errMsg, nil, ok )
+	checkEquals( errMsg, "timeout", reason )
+	checkEqualsFloat( "wrong timing", 1.0, time()-t1, 0.02 )
+
+	-- the communication in time cancels the deadline, a timed out party leaves the channel
+	PAR(
+		function()
+			local a, b = ch:IN_TIMEOUT( 1 )
+			checkEquals( errMsg, 3, a )
+			checkEquals( errMsg, 4, b )
+			checkEquals( errMsg, true, ch:OUT_TIMEOUT( 1, 5 ) )
+			checkEquals( errMsg, nil, ch:IN_TIMEOUT( 0.1 ) )
+			checkEquals( errMsg, 6, ch:IN() )
+		end,
+		function()
+			SLEEP( 0.5 )
+			ch:OUT( 3, 4 )
+			checkEquals( errMsg, 5, ch:IN() )
+			SLEEP( 0.5 )
+			ch:OUT( 6 )
+		end
+	)
+	checkEqualsFloat( "wrong timing", 2.0, time()-t1, 0.02 )
+
+	local buffered = Channel:new( 1 )
+	checkEquals( errMsg, true, buffered:OUT_TIMEOUT( 1, 7 ) )
+	checkEquals( errMsg, nil, buffered:OUT_TIMEOUT( 0.1, 8 ) )
+	checkEquals( errMsg, 7, buffered:IN_TIMEOUT( 1 ) )
+
+	-- a terminated wait leaves no timer behind
+	PARWHILE(
+		function()
+			SLEEP( 0.1 )
+		end,
+		function()
+			ch:IN_TIMEOUT( 0.2 )
+		end
+	)
+	checkEqualsFloat( "wrong timing", 2.2, time()-t1, 0.02 )
+
+	PAR(
+		function()
+			local value, reason = ch:IN_TIMEOUT( 1 )
+			checkEquals( errMsg, nil, value )
+			checkEquals( errMsg, "closed", reason )
+		end,
+		function()
+			ch:close()
+		end
+	)
+	checkEqualsFloat( "wrong timing", 2.2, time()-t1, 0.02 )
+
+	-- the values aren't taken from a closed channel
+	local closing = Channel:new()
+	PAR(
+		function()
+			local ok, reason = closing:OUT_TIMEOUT( 1, 9 )
+			checkEquals( errMsg, nil, ok )
+			checkEquals( errMsg, "closed", reason )
+		end,
+		function()
+			SLEEP( 0.1 )
+			closing:close()
+		end
+	)
+	checkEqualsFloat( "wrong timing", 2.3, time()-t1, 0.02 )
+
+	ok, reason = closing:OUT_TIMEOUT( 1, 10 )
+	checkEquals( errMsg, nil, ok )
+	checkEquals( errMsg, "closed", reason )
+	checkEqualsFloat( "wrong timing", 2.3, time()-t1, 0.02 )
+
+	ok, reason = closing:IN_TIMEOUT( 1 )
+	checkEquals( errMsg, nil, ok )
+	checkEquals( errMsg, "closed", reason )
+	checkEqualsFloat( "wrong timing", 2.3, time()-t1, 0.02 )
+
+	-- a message without values is still told apart from a close
+	local empty = Channel:new()
+	PAR(
+		function()
+			checkEqualsInt( errMsg, 0, select( "#", empty:IN_TIMEOUT( 1 ) ) )
+		end,
+		function()
+			empty:OUT()
+		end
+	)
+end
+
+function elementary:typeChecks()
+	local ch = Channel:new()
+	local swarm = Swarm:new()
+	local sel = Selector:new( ch, function() end )
+	local errMsg = "csp objects must be told apart"
+
+	checkEquals( errMsg, false, pcall( ch.close, swarm ) )
+	checkEquals( errMsg, false, pcall( ch.close, sel ) )
+	checkEquals( errMsg, false, pcall( swarm.go, ch, function() end ) )
+	checkEquals( errMsg, false, pcall( sel.SELECT, ch ) )
+	checkEquals( errMsg, false, pcall( ALT, swarm, function() end ) )
+	checkEquals( errMsg, false, pcall( Selector.new, Selector, sel, function() end ) )
+
+	-- a host's own userdata is never read as a csp object, even with the same bytes
+	local foreign = HOST_USERDATA( ch )
+	checkEquals( errMsg, false, pcall( ch.close, foreign ) )
+	checkEquals( errMsg, false, pcall( ALT, foreign, function() end ) )
+	getmetatable( ch ).__gc( foreign )
+
+	checkEquals( errMsg, false, ch:TRY_IN() )
+	ch:close()
+end
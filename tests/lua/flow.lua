@@ -86,3 +86,60 @@ function flow:precedenceInOut()
 
 	checkEquals( "wrong simulation step order", "f0123456", flow )
 end
+
+local blockedWritersChunk = [[
+	result = ""
+
+	function main()
+		local ch = Channel:new()
+		local branches = {}
+		for i = 1, 5 do
+			branches[i] = function()
+				ch:OUT( i )
+				result = result .. i
+			end
+		end
+		branches[6] = function()
+			SLEEP(0)
+			for i = 1, 5 do
+				local value = ch:IN()
+				result = result .. "<" .. value
+			end
+		end
+
+		PAR( table.unpack( branches ) )
+	end
+]]
+
+function flow:fifoWakeUps()
+	-- the channel serves the writers in arrival order in both modes: only their wake-ups differ.
+	-- LIFO resumes the last served writer first, FIFO resumes each writer before the reader takes the next value.
+	checkEquals( "wrong lifo order", "<1<2<3<4<554321", RUN_HOST( "lifo", blockedWritersChunk ) )
+	checkEquals( "wrong fifo order", "<11<22<33<44<55", RUN_HOST( "fifo", blockedWritersChunk ) )
+end
+
+local parWhileHandOffChunk = [[
+	result = "f"
+
+	function main()
+		local ch = Channel:new()
+		PARWHILE(
+			function()
+				ch:IN()
+				result = result .. "1"
+			end,
+			function()
+				SLEEP(0)
+				ch:OUT()
+				result = result .. "2"
+			end
+		)
+		result = result .. "3"
+	end
+]]
+
+function flow:fifoTerminatesFirst()
+	-- the finished reader notifies PARWHILE before the writer it was handed the values by resumes
+	checkEquals( "wrong lifo order", "f13", RUN_HOST( "lifo", parWhileHandOffChunk ) )
+	checkEquals( "wrong fifo order", "f13", RUN_HOST( "fifo", parWhileHandOffChunk ) )
+end
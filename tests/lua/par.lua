@@ -113,3 +113,75 @@ function testpar:parNested()
 	endTickCheck( self, 0)
 end
 
+
+function testpar:workInsideIdleTree()
+	startTickCheck( self )
+	local ch = Channel:new()
+	local idle = {}
+	local readers = {}
+	for i=1,100 do
+		idle[i] = Channel:new()
+		readers[i] = function() idle[i]:IN() end
+	end
+	local flow = "f"
+	PAR(
+		function()
+			PAR( table.unpack( readers ) )
+			flow = flow.."4"
+		end,
+		function()
+			ALT(
+				ch, function()
+					flow = flow.."2"
+					PAR(
+						function() LUA_SLEEP( 3 ) end,
+						function() sleepTicks( 1 ) end
+					)
+					flow = flow.."3"
+					for i=1,#idle do idle[i]:close() end
+				end
+			)
+		end,
+		function()
+			flow = flow.."1"
+			ch:OUT()
+		end
+	)
+	checkEquals("wrong flow", "f1234", flow )
+	endTickCheck( self, 3 )
+end
+
+
+function testpar:loopReusesThreads()
+	startTickCheck( self )
+	local depth = 0
+
+	local function recurse( n )
+		if n == 0 then return 0 end
+		return 1 + recurse( n-1 )
+	end
+
+	local before = stats()
+	for i=1,100 do
+		PAR(
+			function()
+				-- grows the branch stack: such a thread is not recycled
+				if i % 10 == 0 then depth = depth + recurse( 500 ) end
+			end,
+			function()
+			end
+		)
+	end
+	local after = stats()
+
+	local hits = after.numThreadPoolHits - before.numThreadPoolHits
+	local misses = after.numThreadPoolMisses - before.numThreadPoolMisses
+	local discards = after.numThreadPoolDiscards - before.numThreadPoolDiscards
+
+	checkEquals("wrong depth", 5000, depth )
+	checkEqualsInt("threads acquired", 200, hits + misses )
+	checkEqualsInt("threads discarded", 10, discards )
+	-- only the first loop and the loops after a discard can miss
+	checkEquals("threads not reused", true, hits >= 200 - 2 - 10 )
+	endTickCheck( self, 0)
+end
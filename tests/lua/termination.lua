@@ -79,3 +79,22 @@ function termination:onInput()
 	endTickCheck( self, 0)
 end
 
+
+function termination:largeSubtree()
+	local finished = 0
+
+	local closures = {}
+	closures[1] = function()
+		SLEEP( 0.5 )
+	end
+	for i = 2, 10001 do
+		closures[i] = function()
+			SLEEP( 0.5 )
+			SLEEP( 0.5 )
+			finished = finished + 1
+		end
+	end
+	PARWHILE( table.unpack( closures ) )
+
+	checkEqualsInt( "sub-processes not terminated", 0, finished )
+end
@@ -0,0 +1,288 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "multihost.h"
+
+#include <luacpp/luastackvalue.h>
+
+#include <luacsp/csp.h>
+#include <luacsp/host.h>
+#include <luacsp/hostpool.h>
+#include <luacsp/crosshostchannel.h>
+
+#include <core/thread.h>
+
+#include <string.h>
+
+namespace
+{
+	// Each host spends a different amount of work per tick, so idle workers steal hosts from busy ones.
+	const char* const HOST_COUNTER_CHUNK =
+		"ticks = 0\n"
+		"function main()\n"
+		"	for i = 1, NUM_TICKS do\n"
+		"		local sum = 0\n"
+		"		for j = 1, WORK_PER_TICK do sum = sum + j end\n"
+		"		ticks = ticks + 1\n"
+		"		SLEEP(0)\n"
+		"	end\n"
+		"end\n";
+
+	const char* const PRODUCER_CHUNK =
+		"function main()\n"
+		"	for i = 1, COUNT do\n"
+		"		ch:OUT( i, 'v' .. i )\n"
+		"	end\n"
+		"end\n";
+
+	const char* const CONSUMER_CHUNK =
+		"received, sum, outOfOrder = 0, 0, 0\n"
+		"function main()\n"
+		"	for i = 1, COUNT do\n"
+		"		local value, text = ch:IN()\n"
+		"		if value ~= i or text ~= 'v' .. i then outOfOrder = outOfOrder + 1 end\n"
+		"		received = received + 1\n"
+		"		sum = sum + value\n"
+		"	end\n"
+		"end\n";
+
+	// A host with its own thread: runs main and ticks until it finishes or runs out of time.
+	// The threads run freely, so a tick count can't bound the test: one host may tick many times
+	// before the other one gets scheduled.
+	struct HostThread
+	{
+		csp::Host* pHost;
+		double timeout;
+		bool finished;
+		core::Thread thread;
+	};
+
+	void HostThreadEntry( void* pArgument )
+	{
+		HostThread& hostThread = *static_cast< HostThread* >( pArgument );
+		csp::Host& host = *hostThread.pHost;
+
+		const csp::CspTime_t dt = 1.0f / 60.0f;
+
+		double deadline = core::HighResolutionTime() + hostThread.timeout;
+
+		csp::WorkResult::Enum result = host.Main();
+		while( result == csp::WorkResult::YIELD && core::HighResolutionTime() < deadline )
+			result = host.Work( dt );
+
+		hostThread.finished = result == csp::WorkResult::FINISH;
+	}
+
+	bool LoadChunk( csp::Host& host, const char* chunk, const char* chunkname )
+	{
+		lua::LuaState& luaState = host.LuaState();
+		if( luaState.LoadFromMemory( chunk, strlen( chunk ), chunkname ) != lua::Return::OK )
+			return false;
+
+		return luaState.Call( 0, 0 ) == lua::Return::OK;
+	}
+
+	void SetGlobalInteger( csp::Host& host, const char* name, int value )
+	{
+		lua::LuaStack& stack = host.LuaState().GetStack();
+		lua::LuaStackValue globals = stack.PushGlobalTable();
+		stack.PushInteger( value );
+		stack.SetField( globals, name );
+		stack.Pop( 1 );
+	}
+
+	int GetGlobalInteger( csp::Host& host, const char* name )
+	{
+		lua::LuaStack& stack = host.LuaState().GetStack();
+		lua::LuaStackValue value = stack.PushGlobalValue( name );
+		int result = value.IsNumber() ? value.GetInteger() : -1;
+		stack.Pop( 1 );
+		return result;
+	}
+}
+
+// RUN_HOST_POOL( numWorkers, numHosts, numTicks ): runs a pool of hosts, each counting numTicks ticks.
+// Returns the number of hosts which counted every tick and the number of global ticks the pool ran.
+int RUN_HOST_POOL( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	int numWorkers = args[1].CheckInteger();
+	int numHosts = args[2].CheckInteger();
+	int numTicks = args[3].CheckInteger();
+
+	csp::HostPool pool;
+	pool.Initialize( numWorkers );
+
+	int numLoaded = 0;
+	for( int i = 0; i < numHosts; ++i )
+	{
+		csp::Host& host = pool.CreateHost();
+		SetGlobalInteger( host, "NUM_TICKS", numTicks );
+		SetGlobalInteger( host, "WORK_PER_TICK", 1000 * ( i + 1 ) );
+		if( LoadChunk( host, HOST_COUNTER_CHUNK, "=hostcounter" ) )
+			++numLoaded;
+	}
+
+	int numPoolTicks = 0;
+	if( numLoaded == numHosts )
+	{
+		const csp::CspTime_t dt = 1.0f / 60.0f;
+
+		csp::WorkResult::Enum result = pool.Main();
+		while( result == csp::WorkResult::YIELD && numPoolTicks <= numTicks )
+		{
+			result = pool.Work( dt );
+			++numPoolTicks;
+		}
+	}
+
+	int numCompleted = 0;
+	for( int i = 0; i < pool.NumHosts(); ++i )
+	{
+		if( !pool.IsHostRunning( i ) && GetGlobalInteger( pool.GetHost( i ), "ticks" ) == numTicks )
+			++numCompleted;
+	}
+
+	pool.Shutdown();
+
+	args.PushInteger( numCompleted );
+	args.PushInteger( numPoolTicks );
+	return 2;
+}
+
+// CROSS_HOST_TRANSFER( count, capacity ): a producer host sends count messages to a consumer host
+// through a CrossHostChannel, each host ticking on its own thread.
+// Returns the number of messages received, the sum of their first values and the number of messages out of order.
+int CROSS_HOST_TRANSFER( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	int count = args[1].CheckInteger();
+	int capacity = args[2].CheckInteger();
+
+	csp::CrossHostChannel* pChannel = csp::CrossHostChannel::Create( capacity );
+
+	HostThread hostThreads[ 2 ];
+	const char* const chunks[ 2 ] = { PRODUCER_CHUNK, CONSUMER_CHUNK };
+
+	bool loaded = true;
+	for( int i = 0; i < 2; ++i )
+	{
+		HostThread& hostThread = hostThreads[ i ];
+		hostThread.pHost = &csp::Initialize();
+		hostThread.timeout = 30.0;
+		hostThread.finished = false;
+
+		csp::Host& host = *hostThread.pHost;
+		lua::LuaStack& stack = host.LuaState().GetStack();
+		lua::LuaStackValue globals = stack.PushGlobalTable();
+		csp::PushCrossHostChannel( stack.InternalState(), *pChannel );
+		stack.SetField( globals, "ch" );
+		stack.Pop( 1 );
+
+		SetGlobalInteger( host, "COUNT", count );
+		loaded = LoadChunk( host, chunks[ i ], "=crosshost" ) && loaded;
+	}
+	// the handles keep the channel alive
+	pChannel->Release();
+
+	if( loaded )
+	{
+		for( int i = 0; i < 2; ++i )
+			hostThreads[ i ].thread.Start( &HostThreadEntry, &hostThreads[ i ] );
+		for( int i = 0; i < 2; ++i )
+			hostThreads[ i ].thread.Join();
+	}
+
+	csp::Host& consumer = *hostThreads[ 1 ].pHost;
+	bool finished = hostThreads[ 0 ].finished && hostThreads[ 1 ].finished;
+
+	args.PushInteger( finished ? GetGlobalInteger( consumer, "received" ) : -1 );
+	args.PushInteger( GetGlobalInteger( consumer, "sum" ) );
+	args.PushInteger( GetGlobalInteger( consumer, "outOfOrder" ) );
+
+	for( int i = 0; i < 2; ++i )
+	{
+		hostThreads[ i ].pHost->TerminateMain();
+		csp::Shutdown( *hostThreads[ i ].pHost );
+	}
+
+	return 3;
+}
+
+// RUN_HOST( evalOrder, chunk ): runs the chunk's main in a separate host with the "lifo" or "fifo" eval order.
+// Returns the global result of that host, or nil if the chunk failed to load.
+int RUN_HOST( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue evalOrderArg = args[1];
+	lua::LuaStackValue chunkArg = args[2];
+
+	if( !evalOrderArg.IsString() || ( strcmp( evalOrderArg.GetString(), "lifo" ) != 0 && strcmp( evalOrderArg.GetString(), "fifo" ) != 0 ) )
+		return evalOrderArg.ArgError( "\"lifo\" or \"fifo\" expected" );
+	if( !chunkArg.IsString() )
+		return chunkArg.ArgError( "chunk string expected" );
+
+	bool fifo = strcmp( evalOrderArg.GetString(), "fifo" ) == 0;
+	size_t chunkLength = 0;
+	const char* chunk = chunkArg.GetLString( chunkLength );
+
+	csp::Host& host = csp::Initialize();
+	host.SetEvalOrder( fifo ? csp::EvalOrder::FIFO : csp::EvalOrder::LIFO );
+
+	lua::LuaState& hostState = host.LuaState();
+	hostState.LibOpenBase();
+	hostState.LibOpenTable();
+
+	bool loaded = hostState.LoadFromMemory( chunk, chunkLength, "=runhost" ) == lua::Return::OK
+		&& hostState.Call( 0, 0 ) == lua::Return::OK;
+
+	if( loaded )
+	{
+		const csp::CspTime_t dt = 1.0f / 60.0f;
+
+		csp::WorkResult::Enum result = host.Main();
+		while( result == csp::WorkResult::YIELD )
+			result = host.Work( dt );
+
+		lua::LuaStack& stack = hostState.GetStack();
+		lua::LuaStackValue value = stack.PushGlobalValue( "result" );
+		if( value.IsString() )
+			args.PushString( value.GetString() );
+		else
+			args.PushNil();
+		stack.Pop( 1 );
+	}
+	else
+		args.PushNil();
+
+	host.TerminateMain();
+	csp::Shutdown( host );
+
+	return 1;
+}
+
+const csp::FunctionRegistration multiHostGlobals[] =
+{
+	  "RUN_HOST_POOL", RUN_HOST_POOL
+	, "CROSS_HOST_TRANSFER", CROSS_HOST_TRANSFER
+	, "RUN_HOST", RUN_HOST
+	, NULL, NULL
+};
+
+void InitializeMultiHost( lua::LuaState& state )
+{
+	lua::LuaStackValue globals = state.GetStack().PushGlobalTable();
+	RegisterFunctions( state, globals, multiHostGlobals );
+	state.GetStack().Pop(1);
+}
+
+void ShutdownMultiHost( lua::LuaState& state )
+{
+	lua::LuaStackValue globals = state.GetStack().PushGlobalTable();
+	UnregisterFunctions( state, globals, multiHostGlobals );
+	state.GetStack().Pop(1);
+}
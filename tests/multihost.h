@@ -0,0 +1,14 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <luacpp/luacpp.h>
+
+// Globals which run several hosts on several threads. The hosts are created and shut down inside one call.
+void InitializeMultiHost( lua::LuaState& state );
+void ShutdownMultiHost( lua::LuaState& state );
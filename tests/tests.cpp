@@ -13,6 +13,9 @@
 
 #include <luatest/luatest.h>
 
+#include "typedchannels.h"
+#include "multihost.h"
+
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -67,10 +70,11 @@ TestsResult::Enum EvaluateLuaMain( csp::Host& host )
 	TestsResult::Enum result = TestsResult::LUA_ERROR;
 
 	const float dt = 1.0f / 60.0f;
+	const int instructionBudget = 1000000;
 
 	csp::WorkResult::Enum workResult = host.Main();
 	while( workResult == lua::Return::YIELD )
-		workResult = host.Work( dt );
+		workResult = host.AdvanceToNextEvent( dt, instructionBudget );
 
 	result = TestsResult::OK;
 
@@ -95,6 +99,8 @@ int main( int argc, const char* argv[] )
 	luaState.LibOpenTable();
 
 	csp::InitTests( luaState );
+	InitializeTypedChannels( luaState );
+	InitializeMultiHost( luaState );
 
 	for( int i = 1; i < argc; ++i )
 	{
@@ -109,6 +115,8 @@ int main( int argc, const char* argv[] )
 		result = EvaluateLuaMain( host );
 	}
 
+	ShutdownMultiHost( luaState );
+	ShutdownTypedChannels( luaState );
 	csp::ShutdownTests( luaState );
 
 	csp::Shutdown( host );
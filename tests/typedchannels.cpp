@@ -0,0 +1,170 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#include "typedchannels.h"
+
+#include <luacpp/luastackvalue.h>
+
+#include <string.h>
+
+OpProduceSamples::OpProduceSamples()
+	: m_count( 0 )
+	, m_numTaken( 0 )
+{
+}
+
+OpProduceSamples::~OpProduceSamples()
+{
+}
+
+bool OpProduceSamples::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !args[2].IsNumber() )
+		return initError.ArgError( 2, "number of samples expected." );
+
+	m_count = args[2].GetInteger();
+
+	return OpTypedOut< Sample >::Init( args, initError );
+}
+
+csp::WorkResult::Enum OpProduceSamples::Update( csp::CspTime_t )
+{
+	if( m_numTaken == m_count && !IsOutputAttached() )
+		return csp::WorkResult::FINISH;
+
+	return csp::WorkResult::YIELD;
+}
+
+bool OpProduceSamples::IsOutputReady() const
+{
+	return m_numTaken < m_count;
+}
+
+void OpProduceSamples::TakeOutput( Sample& payload )
+{
+	++m_numTaken;
+	payload.id = m_numTaken;
+	payload.value = m_numTaken * 0.5f;
+}
+
+int OpProduceSamples::PushPayload( lua::LuaStack& luaStack, const Sample& payload )
+{
+	luaStack.PushInteger( payload.id );
+	luaStack.PushNumber( payload.value );
+	return 2;
+}
+
+
+OpSumSamples::OpSumSamples()
+	: m_count( 0 )
+	, m_numConsumed( 0 )
+	, m_numConverted( 0 )
+	, m_idSum( 0 )
+{
+}
+
+OpSumSamples::~OpSumSamples()
+{
+}
+
+bool OpSumSamples::Init( lua::LuaStack& args, InitError& initError )
+{
+	if( !args[2].IsNumber() )
+		return initError.ArgError( 2, "number of samples expected." );
+
+	m_count = args[2].GetInteger();
+
+	return OpTypedIn< Sample >::Init( args, initError );
+}
+
+int OpSumSamples::PushResults( lua::LuaStack& luaStack )
+{
+	OpTypedIn< Sample >::PushResults( luaStack );
+
+	luaStack.PushInteger( m_idSum );
+	luaStack.PushInteger( m_numConverted );
+	return 2;
+}
+
+csp::WorkResult::Enum OpSumSamples::Update( csp::CspTime_t )
+{
+	return m_numConsumed == m_count ? csp::WorkResult::FINISH : csp::WorkResult::YIELD;
+}
+
+bool OpSumSamples::IsInputReady() const
+{
+	return m_numConsumed < m_count;
+}
+
+void OpSumSamples::ConsumeInput( Sample& payload )
+{
+	++m_numConsumed;
+	m_idSum += payload.id;
+}
+
+bool OpSumSamples::ReadPayload( lua::LuaStack& luaStack, int numValues, Sample& payload )
+{
+	if( numValues < 1 )
+		return false;
+
+	lua::LuaStackValue id = luaStack[ luaStack.GetTop() - numValues + 1 ];
+	if( !id.IsNumber() )
+		return false;
+
+	++m_numConverted;
+	payload.id = id.GetInteger();
+	payload.value = 0;
+	return true;
+}
+
+
+int PRODUCE_SAMPLES( lua_State* luaState )
+{
+	OpProduceSamples* pOperation = CORE_NEW OpProduceSamples();
+	return pOperation->DoInit( luaState );
+}
+
+int SUM_SAMPLES( lua_State* luaState )
+{
+	OpSumSamples* pOperation = CORE_NEW OpSumSamples();
+	return pOperation->DoInit( luaState );
+}
+
+// HOST_USERDATA( object ): a userdata of the host's own, without a metatable, holding a copy of the object's bytes.
+int HOST_USERDATA( lua_State* luaState )
+{
+	lua::LuaStack args( luaState );
+	lua::LuaStackValue object = args[1];
+	if( !object.IsUserData() )
+		return object.ArgError( "userdata expected." );
+
+	size_t size = object.RawLength();
+	memcpy( args.PushUserData( size ), object.GetUserData(), size );
+	return 1;
+}
+
+const csp::FunctionRegistration typedChannelGlobals[] =
+{
+	  "PRODUCE_SAMPLES", PRODUCE_SAMPLES
+	, "SUM_SAMPLES", SUM_SAMPLES
+	, "HOST_USERDATA", HOST_USERDATA
+	, NULL, NULL
+};
+
+void InitializeTypedChannels( lua::LuaState& state )
+{
+	lua::LuaStackValue globals = state.GetStack().PushGlobalTable();
+	RegisterFunctions( state, globals, typedChannelGlobals );
+	state.GetStack().Pop(1);
+}
+
+void ShutdownTypedChannels( lua::LuaState& state )
+{
+	lua::LuaStackValue globals = state.GetStack().PushGlobalTable();
+	UnregisterFunctions( state, globals, typedChannelGlobals );
+	state.GetStack().Pop(1);
+}
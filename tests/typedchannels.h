@@ -0,0 +1,60 @@
+/**
+ * This file is a part of LuaCSP library.
+ * Copyright (c) 2012-2013 Alexey Baskakov
+ * Project page: http://github.com/loyso/LuaCSP
+ * This library is distributed under the GNU General Public License (GPL), version 2.
+ * The above copyright notice shall be included in all copies or substantial portions of the Software.
+ */
+#pragma once
+
+#include <luacsp/cppchannel.h>
+
+struct Sample
+{
+	int id;
+	float value;
+};
+
+// PRODUCE_SAMPLES( ch, count ): sends samples 1..count.
+class OpProduceSamples : public csp::OpTypedOut< Sample >
+{
+public:
+	OpProduceSamples();
+	virtual ~OpProduceSamples();
+
+private:
+	virtual bool Init( lua::LuaStack& args, InitError& initError );
+
+	virtual csp::WorkResult::Enum Update( csp::CspTime_t dt );
+	virtual bool IsOutputReady() const;
+	virtual void TakeOutput( Sample& payload );
+	virtual int PushPayload( lua::LuaStack& luaStack, const Sample& payload );
+
+	int m_count;
+	int m_numTaken;
+};
+
+// SUM_SAMPLES( ch, count ): receives count samples, returns the sum of ids and the number of samples sent by Lua.
+class OpSumSamples : public csp::OpTypedIn< Sample >
+{
+public:
+	OpSumSamples();
+	virtual ~OpSumSamples();
+
+private:
+	virtual bool Init( lua::LuaStack& args, InitError& initError );
+	virtual int PushResults( lua::LuaStack& luaStack );
+
+	virtual csp::WorkResult::Enum Update( csp::CspTime_t dt );
+	virtual bool IsInputReady() const;
+	virtual void ConsumeInput( Sample& payload );
+	virtual bool ReadPayload( lua::LuaStack& luaStack, int numValues, Sample& payload );
+
+	int m_count;
+	int m_numConsumed;
+	int m_numConverted;
+	int m_idSum;
+};
+
+void InitializeTypedChannels( lua::LuaState& state );
+void ShutdownTypedChannels( lua::LuaState& state );